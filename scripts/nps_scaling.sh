@@ -0,0 +1,32 @@
+#!/bin/bash
+
+# Runs the bench at several thread counts and prints the speed at each,
+# along with how it scales against a single thread, and the time the first
+# thread took to reach the bench depth.
+# Usage: scripts/nps_scaling.sh [binary] [depth] [hash]
+# The thread counts can be set with THREADS, e.g. THREADS="1 2 4".
+
+BINARY=${1:-./atom}
+DEPTH=${2:-13}
+HASH=${3:-64}
+THREADS=${THREADS:-"1 8 64"}
+
+BASE_NPS=""
+
+printf "%8s %12s %10s %12s %12s\n" "Threads" "NPS" "Speedup" "Per thread" "Time (ms)"
+
+for T in $THREADS; do
+    OUTPUT=$($BINARY bench "$DEPTH" "$T" "$HASH")
+    NPS=$(echo "$OUTPUT" | awk '/Nodes\/second/ { print $3 }')
+    TIME=$(echo "$OUTPUT" | awk '/Total time/ { print $5 }')
+
+    if [ -z "$NPS" ]; then
+        echo "Bench failed with $T threads"
+        exit 1
+    fi
+
+    BASE_NPS=${BASE_NPS:-$((NPS / T))}
+
+    awk -v t="$T" -v nps="$NPS" -v base="$BASE_NPS" -v time="$TIME" \
+        'BEGIN { printf "%8d %12d %9.2fx %11.1f%% %12d\n", t, nps, nps / base, 100 * nps / (base * t), time }'
+done
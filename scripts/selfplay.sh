@@ -0,0 +1,48 @@
+#!/bin/bash
+
+# Plays two builds against each other at a fixed time per move, to check that
+# a change to the parallel search makes good use of extra threads.
+# Usage: scripts/selfplay.sh <engine> <baseline> [threads] [movetime] [games]
+# where movetime is in milliseconds. Needs fastchess, looked up from
+# FASTCHESS, the PATH, then the tuner directory. An EPD or PGN opening book
+# can be given with OPENINGS, otherwise every game starts from the start
+# position.
+#
+# To see how well threads scale, run the same build against itself with
+# 1 thread and then more, e.g. THREADS_BASE=1 scripts/selfplay.sh atom atom 8
+
+ENGINE=$1
+BASELINE=$2
+THREADS=${3:-8}
+MOVETIME=${4:-200}
+GAMES=${5:-200}
+THREADS_BASE=${THREADS_BASE:-$THREADS}
+HASH=${HASH:-64}
+
+if [ -z "$ENGINE" ] || [ -z "$BASELINE" ]; then
+    echo "Usage: $0 <engine> <baseline> [threads] [movetime] [games]"
+    exit 1
+fi
+
+FASTCHESS=${FASTCHESS:-$(command -v fastchess || echo tuning/tuner/fastchess)}
+
+if [ ! -x "$FASTCHESS" ]; then
+    echo "fastchess not found: set FASTCHESS or place it in tuning/tuner"
+    exit 1
+fi
+
+OPENING_ARGS=()
+if [ -n "$OPENINGS" ]; then
+    OPENING_ARGS=(-openings file="$OPENINGS" format="${OPENINGS##*.}" order=random)
+fi
+
+ST=$(awk -v ms="$MOVETIME" 'BEGIN { printf "%.3f", ms / 1000 }')
+
+"$FASTCHESS" \
+    -engine cmd="$ENGINE" name="engine-${THREADS}t" option.Threads="$THREADS" \
+    -engine cmd="$BASELINE" name="baseline-${THREADS_BASE}t" option.Threads="$THREADS_BASE" \
+    -each proto=uci st="$ST" timemargin=100 option.Hash="$HASH" \
+    -rounds $((GAMES / 2)) -games 2 -repeat \
+    "${OPENING_ARGS[@]}" \
+    -concurrency 1 \
+    -pgnout file=selfplay.pgn
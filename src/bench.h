@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace Atom {
+
+namespace Bench {
+
+// Defaults for the bench command: bench [depth] [threads] [hash]
+constexpr int    BENCH_DEPTH_DEFAULT   = 10;
+constexpr size_t BENCH_THREADS_DEFAULT = 1;
+constexpr size_t BENCH_HASH_DEFAULT    = 16;
+
+// Positions searched by the bench command
+extern const std::vector<std::string> POSITIONS;
+
+} // namespace Bench
+
+} // namespace Atom
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+
+namespace Atom {
+
+// A single producer, single consumer queue of input lines.
+// The UCI input thread pushes commands and the main thread pops them.
+// Neither side takes a lock: the consumer sleeps on the write index
+// (a futex on Linux) when there is nothing to do.
+class CommandQueue {
+public:
+    static constexpr size_t SIZE = 256;
+    static_assert((SIZE & (SIZE - 1)) == 0, "SIZE must be a power of 2");
+
+    // Adds a command to the back of the queue, waiting if the queue is full.
+    void push(std::string command) {
+        const size_t w = writeIdx.load(std::memory_order_relaxed);
+
+        while (w - readIdx.load(std::memory_order_acquire) == SIZE) {
+            std::this_thread::yield();
+        }
+
+        buffer[w & (SIZE - 1)] = std::move(command);
+        writeIdx.store(w + 1, std::memory_order_release);
+        writeIdx.notify_one();
+    }
+
+    // Takes the command at the front of the queue, sleeping until there is one.
+    std::string pop() {
+        const size_t r = readIdx.load(std::memory_order_relaxed);
+
+        size_t w;
+        while ((w = writeIdx.load(std::memory_order_acquire)) == r) {
+            writeIdx.wait(w, std::memory_order_acquire);
+        }
+
+        std::string command = std::move(buffer[r & (SIZE - 1)]);
+        readIdx.store(r + 1, std::memory_order_release);
+
+        return command;
+    }
+
+private:
+    std::array<std::string, SIZE> buffer;
+
+    // Kept on separate cache lines, as each is written by a different thread.
+    alignas(64) std::atomic<size_t> readIdx  = 0;
+    alignas(64) std::atomic<size_t> writeIdx = 0;
+};
+
+} // namespace Atom
@@ -0,0 +1,66 @@
+#include <cstdio>
+#include <cstdlib>
+
+#include "cpu.h"
+
+namespace Atom {
+
+namespace Cpu {
+
+const char* isaName(Isa isa) {
+    constexpr const char* names[] = {"generic", "sse2", "sse41", "avx2", "bmi2", "avx512", "vnni512"};
+    return names[isa];
+}
+
+
+Isa hostIsa() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+
+    if (   __builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512vl")
+        && __builtin_cpu_supports("avx512bw")   && __builtin_cpu_supports("avx512dq"))
+        return ISA_VNNI512;
+
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq"))
+        return ISA_AVX512;
+
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2"))
+        return ISA_BMI2;
+
+    if (__builtin_cpu_supports("avx2"))
+        return ISA_AVX2;
+
+    if (__builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("popcnt"))
+        return ISA_SSE41;
+
+    if (__builtin_cpu_supports("sse2"))
+        return ISA_SSE2;
+#endif
+
+    return ISA_GENERIC;
+}
+
+
+namespace {
+
+// Exits cleanly, rather than with an illegal instruction, on a CPU that lacks
+// the instruction set the engine outside the NNUE kernels is built for (those
+// are picked to suit the CPU, see network.h). Static initializers elsewhere
+// are compiled for that instruction set, so this has to run before all of
+// them: it has the highest constructor priority, and this file is built
+// without any -m flags (see the Makefile). std::cout may not be set up yet,
+// so stdio is used.
+[[gnu::constructor(101)]] void checkHostIsa() {
+    if (hostIsa() >= CompiledIsa) return;
+
+    std::printf("Error: this binary needs %s, but this CPU only supports %s.\n",
+                isaName(CompiledIsa), isaName(hostIsa()));
+    std::fflush(stdout);
+    std::_Exit(EXIT_FAILURE);
+}
+
+} // namespace
+
+} // namespace Cpu
+
+} // namespace Atom
@@ -0,0 +1,46 @@
+#pragma once
+
+namespace Atom {
+
+namespace Cpu {
+
+// The instruction sets the NNUE kernels can be built for, from oldest to newest.
+// The engine itself needs at least BMI2 (pext is used for slider attacks).
+enum Isa {
+    ISA_GENERIC,
+    ISA_SSE2,
+    ISA_SSE41,
+    ISA_AVX2,
+    ISA_BMI2,
+    ISA_AVX512,
+    ISA_VNNI512,
+};
+
+const char* isaName(Isa isa);
+
+// The instruction set the file using this is compiled for. The NNUE kernels
+// are compiled for several (see network_kernels.cpp), the rest of the engine
+// for the one of its CPU flags.
+constexpr Isa CompiledIsa =
+#if defined(USE_VNNI)
+    ISA_VNNI512;
+#elif defined(USE_AVX512)
+    ISA_AVX512;
+#elif defined(USE_BMI2)
+    ISA_BMI2;
+#elif defined(USE_AVX2)
+    ISA_AVX2;
+#elif defined(USE_SSE41)
+    ISA_SSE41;
+#elif defined(USE_SSE2)
+    ISA_SSE2;
+#else
+    ISA_GENERIC;
+#endif
+
+// The newest instruction set this CPU supports, found through CPUID
+Isa hostIsa();
+
+} // namespace Cpu
+
+} // namespace Atom
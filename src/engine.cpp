@@ -1,13 +1,25 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
+#include <fstream>
+#include <iomanip>
 #include <memory>
+#include <optional>
+#include <span>
 #include <sstream>
+#include <thread>
 #include <vector>
 
+#include "bench.h"
 #include "engine.h"
 #include "evaluate.h"
+#include "movegen.h"
 #include "nnue.h"
 #include "nnue/network.h"
 #include "nnue/nnue_misc.h"
+#include "memory.h"
+#include "numa.h"
 #include "perft.h"
 #include "position.h"
 #include "search.h"
@@ -26,29 +38,43 @@ Engine::Engine() :
         )
     ) {
     loadInternalNNUEs();
-    Search::SearchWorkerShared sharedState = {threads, networks, tt};
-    threads.setNbThreads(NB_THREADS_DEFAULT, sharedState);
+    setNbThreads(NB_THREADS_DEFAULT);
 }
 
 
 // Clears everything and sets a new game
 void Engine::newGame() {
     pos.setFromFEN(STARTPOS_FEN);
-    tt.clear();
+    posFen = STARTPOS_FEN;
+    posMoves.clear();
+
+    threads.clearTT(tt);
     threads.clearThreads();
 }
 
 
 // Sets the position according to a given FEN and list of moves.
+// During a game, GUIs resend the whole game with every position command.
+// If the new move list extends the one we were last given from the same
+// FEN, only the new moves are played on top of the current position.
 void Engine::setPosition(const std::string& fen, const std::vector<std::string>& moves) {
-    pos.setFromFEN(fen);
+    const bool extendsCurrent = fen == posFen
+                             && moves.size() >= posMoves.size()
+                             && std::equal(posMoves.begin(), posMoves.end(), moves.begin());
+
+    if (!extendsCurrent) {
+        pos.setFromFEN(fen);
+        posFen = fen;
+        posMoves.clear();
+    }
 
-    for (const std::string& moveStr : moves) {
-        Move m = Uci::toMove(pos, moveStr);
+    for (size_t i = posMoves.size(); i < moves.size(); ++i) {
+        Move m = Uci::toMove(pos, moves[i]);
 
         if (m == MOVE_NULL) break;
 
         pos.doMove(m);
+        posMoves.push_back(moves[i]);
     }
 }
 
@@ -64,6 +90,13 @@ std::string Engine::getDebugInfo() {
     ss << "Orthogonal pin: " << pos.pinOrtho() << std::endl;
     ss << "Checkmask:      " << pos.checkMask() << std::endl;
 
+    // Eval hash usage over the last search
+    waitForSearchFinish();
+    const uint64_t probes = threads.totalEvalHashProbes();
+    const uint64_t hits   = threads.totalEvalHashHits();
+    ss << "Eval hash hits: " << hits << "/" << probes << " ("
+       << std::fixed << std::setprecision(1) << (probes ? 100.0 * hits / probes : 0.0) << "%)" << std::endl;
+
     return ss.str();
 }
 
@@ -74,11 +107,462 @@ void Engine::runPerft(int depth) {
 }
 
 
+// Searches each of the bench positions to a fixed depth, then prints the
+// total nodes searched, the time taken and the speed. The node count acts
+// as a signature: it changes whenever the behaviour of the search does.
+// The options and position set before are restored afterwards.
+void Engine::runBench(int depth, size_t nbThreads, size_t hashSize) {
+    const size_t savedThreads  = threads.size();
+    const size_t savedHashSize = tt.sizeInMb();
+    const std::string savedFen = posFen;
+    const std::vector<std::string> savedMoves = posMoves;
+
+    waitForSearchFinish();
+    setHashSize(hashSize);
+    setNbThreads(nbThreads);
+    clear();
+
+    uint64_t nodes = 0;
+    TimePoint elapsed = 0;
+
+#ifdef SEARCH_STATS
+    BenchStats total{true, nbThreads, {}, {}, {}};
+    total.search.clear();
+#endif
+
+    for (size_t i = 0; i < Bench::POSITIONS.size(); ++i) {
+        std::cout << "Position: " << (i + 1) << "/" << Bench::POSITIONS.size()
+                  << " (" << Bench::POSITIONS[i] << ")" << std::endl;
+
+        setPosition(Bench::POSITIONS[i], {});
+
+        Search::SearchLimits limits;
+        limits.depth = depth;
+        limits.startTimePoint = now();
+
+        go(limits);
+        waitForSearchFinish();
+
+        elapsed += now() - limits.startTimePoint;
+        nodes   += threads.totalNodesSearched();
+
+#ifdef SEARCH_STATS
+        total.search.add(threads.totalStats());
+        total.big.add(threads.totalNnueStatsBig());
+        total.small.add(threads.totalNnueStatsSmall());
+#endif
+    }
+
+    std::cout << std::endl;
+    std::cout << "===========================" << std::endl;
+    std::cout << "Total time (ms) : " << elapsed << std::endl;
+    std::cout << "Nodes searched  : " << nodes << std::endl;
+    std::cout << "Nodes/second    : " << nodes * 1000 / (elapsed + 1) << std::endl;
+
+    setHashSize(savedHashSize);
+    setNbThreads(savedThreads);
+    clear();
+
+#ifdef SEARCH_STATS
+    benchStats = total;
+#endif
+
+    posFen.clear();
+    setPosition(savedFen.empty() ? std::string(STARTPOS_FEN) : savedFen, savedMoves);
+}
+
+
+// Prints the search and NNUE statistics of the last search, summed over all
+// threads, or of every position of the bench if that was run last.
+void Engine::printStats() {
+    waitForSearchFinish();
+
+#ifdef SEARCH_STATS
+    if (benchStats.valid) {
+        std::cout << "Search statistics (bench, " << benchStats.nbThreads << " threads)" << std::endl << std::endl;
+        std::cout << benchStats.search.table() << std::endl;
+        std::cout << "NNUE accumulator updates" << std::endl << std::endl;
+        std::cout << NNUE::update_stats_table(benchStats.big, benchStats.small) << std::endl;
+        return;
+    }
+
+    std::cout << "Search statistics (" << threads.size() << " threads)" << std::endl << std::endl;
+    std::cout << threads.totalStats().table() << std::endl;
+    std::cout << "NNUE accumulator updates" << std::endl << std::endl;
+    std::cout << NNUE::update_stats_table(threads.totalNnueStatsBig(), threads.totalNnueStatsSmall()) << std::endl;
+#else
+    std::cout << "Error: search statistics are not enabled, build with 'make stats'" << std::endl;
+#endif
+}
+
+
+// Times setting up a game of the given length through setPosition, first
+// one move per command as a GUI would send it, then replaying the whole
+// game from the FEN for every command. The game itself is made up of
+// pseudo-random legal moves, so it is the same on every run.
+void Engine::benchSetPosition(int plies) {
+    using namespace std::chrono;
+
+    plies = std::clamp(plies, 1, MAX_HISTORY - MAX_PLY);
+
+    std::vector<std::string> game;
+    Position p;
+    uint64_t seed = 0x2545F4914F6CDD1Dull;
+
+    while (int(game.size()) < plies) {
+        MoveList legal;
+        Movegen::enumerateLegalMoves(p, [&](Move m) {
+            legal.push_back(m);
+            return true;
+        });
+
+        if (legal.empty()) break;
+
+        seed ^= seed << 13, seed ^= seed >> 7, seed ^= seed << 17;
+        Move m = legal[seed % legal.size()];
+
+        game.push_back(Uci::formatMove(m));
+        p.doMove(m);
+    }
+
+    const std::string savedFen = posFen;
+    const std::vector<std::string> savedMoves = posMoves;
+
+    auto run = [&](bool incremental) {
+        std::vector<std::string> moves;
+        posFen.clear();
+
+        auto start = high_resolution_clock::now();
+        for (const std::string& moveStr : game) {
+            moves.push_back(moveStr);
+            if (!incremental) posFen.clear();
+            setPosition(STARTPOS_FEN, moves);
+        }
+
+        return duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+    };
+
+    const auto incrementalTime = run(true);
+    const auto replayTime      = run(false);
+    const size_t n = game.size();
+
+    std::cout << "Game length:     " << n << " plies" << std::endl;
+    std::cout << "Incremental:     " << incrementalTime << " us (" << incrementalTime / n << " us / command)" << std::endl;
+    std::cout << "Full replay:     " << replayTime      << " us (" << replayTime      / n << " us / command)" << std::endl;
+
+    posFen.clear();
+    setPosition(savedFen.empty() ? std::string(STARTPOS_FEN) : savedFen, savedMoves);
+}
+
+
+// Measures how long the thread pool takes to start and stop a search: from
+// go until the first thread and then every thread has started searching, and
+// from stop until the search has finished and sent bestmove. Each search is
+// left to run for a few milliseconds before it is stopped.
+void Engine::benchLatency(size_t nbThreads, int runs) {
+    using namespace std::chrono;
+
+    constexpr auto SEARCH_TIME = milliseconds(5);
+
+    const size_t savedThreads = threads.size();
+    const std::string savedFen = posFen;
+    const std::vector<std::string> savedMoves = posMoves;
+
+    waitForSearchFinish();
+    setNbThreads(nbThreads);
+
+    std::vector<double> firstStart, allStart, stopTime;
+
+    auto us = [](steady_clock::duration d) { return duration<double, std::micro>(d).count(); };
+
+    for (int run = 0; run < runs; ++run) {
+        setPosition(Bench::POSITIONS[run % Bench::POSITIONS.size()], {});
+
+        Search::SearchLimits limits;
+        limits.isInfinite = true;
+        limits.startTimePoint = now();
+
+        // The threads note when they start searching, so nothing polls them
+        const auto start = steady_clock::now();
+        go(limits);
+        std::this_thread::sleep_for(SEARCH_TIME);
+
+        steady_clock::time_point last = start;
+        for (const std::unique_ptr<Thread>& thread : threads)
+            last = std::max(last, thread->worker->getStartedAt());
+
+        firstStart.push_back(us(threads.firstWorker()->getStartedAt() - start));
+        allStart.push_back(us(last - start));
+
+        const auto stopStart = steady_clock::now();
+        stop();
+        waitForSearchFinish();
+        stopTime.push_back(us(steady_clock::now() - stopStart));
+    }
+
+    auto report = [](const char* name, std::vector<double>& samples) {
+        std::sort(samples.begin(), samples.end());
+        double mean = 0;
+        for (double s : samples) mean += s;
+        mean /= samples.size();
+
+        std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(1)
+                  << " mean " << std::setw(9) << mean
+                  << "   median " << std::setw(9) << samples[samples.size() / 2]
+                  << "   max " << std::setw(9) << samples.back() << "   (us)" << std::endl;
+    };
+
+    std::cout << std::endl;
+    std::cout << "===========================" << std::endl;
+    std::cout << "Threads: " << threads.size() << ", runs: " << runs << std::endl;
+    report("go to first thread", firstStart);
+    report("go to all threads", allStart);
+    report("stop to bestmove", stopTime);
+
+    setNbThreads(savedThreads);
+    posFen.clear();
+    setPosition(savedFen.empty() ? std::string(STARTPOS_FEN) : savedFen, savedMoves);
+}
+
+
 // Loads the internal NNUE networks
 void Engine::loadInternalNNUEs() {
     networks.big.load("<internal>", EvalFileDefaultNameBig);
     networks.small.load("<internal>", EvalFileDefaultNameSmall);
     verifyNetworks();
+    replicateNetworks(boundCpus());
+}
+
+
+// Converts a .nnue file into a network cache, which is mapped instead of read
+// when given as EvalFile / EvalFileSmall. Also reports what loading each costs.
+void Engine::convertNetwork(const std::string& input, const std::string& output) {
+    using namespace std::chrono;
+
+    auto mib = [](size_t after, size_t before) { return (double(after) - double(before)) / (1024 * 1024); };
+
+    // Returns false if input is not this type of network
+    auto convert = [&]<typename Network>(Network net, Network mapped, const char* type) {
+        const MemoryUsage beforeRead = memoryUsage();
+        const auto        readStart  = steady_clock::now();
+
+        net.load("", input);
+        if (!net.is_loaded(input)) return false;
+
+        const double      readMs    = duration<double, std::milli>(steady_clock::now() - readStart).count();
+        const MemoryUsage afterRead = memoryUsage();
+
+        if (!net.save_cache(output)) {
+            std::cout << "Error: could not write '" << output << "'" << std::endl;
+            return true;
+        }
+
+        const MemoryUsage beforeMap = memoryUsage();
+        const auto        mapStart  = steady_clock::now();
+
+        mapped.load("", output);
+
+        const double      mapMs    = duration<double, std::milli>(steady_clock::now() - mapStart).count();
+        const MemoryUsage afterMap = memoryUsage();
+
+        if (!mapped.is_loaded(output) || !mapped.is_mapped()) {
+            std::cout << "Error: could not map '" << output << "'" << std::endl;
+            return true;
+        }
+
+        std::cout << "Converted " << input << " (" << type << " net) to " << output << std::endl;
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "Reading .nnue : " << std::setw(8) << readMs << " ms, private memory +"
+                  << mib(afterRead.anon, beforeRead.anon) << " MiB" << std::endl;
+        std::cout << "Mapping cache : " << std::setw(8) << mapMs << " ms, private memory +"
+                  << mib(afterMap.anon, beforeMap.anon) << " MiB, shared memory +"
+                  << mib(afterMap.file, beforeMap.file) << " MiB" << std::endl;
+        std::cout << "The cache is read in as it is used, and shared by every process mapping it." << std::endl;
+
+        return true;
+    };
+
+    waitForSearchFinish();
+
+    if (!convert(NNUE::NetworkBig({EvalFileDefaultNameBig, "None", ""}, NNUE::EmbeddedNNUEType::BIG),
+                 NNUE::NetworkBig({EvalFileDefaultNameBig, "None", ""}, NNUE::EmbeddedNNUEType::BIG), "big")
+     && !convert(NNUE::NetworkSmall({EvalFileDefaultNameSmall, "None", ""}, NNUE::EmbeddedNNUEType::SMALL),
+                 NNUE::NetworkSmall({EvalFileDefaultNameSmall, "None", ""}, NNUE::EmbeddedNNUEType::SMALL), "small")) {
+        std::cout << "Error: '" << input << "' is not a network this build can load" << std::endl;
+    }
+}
+
+
+namespace {
+
+// The order evalBatch evaluates FENs in: by the number of pieces (which picks
+// the layer stack), then by the squares of the kings. Returns nothing if the
+// FEN does not have one king of each color, which positions cannot be set to.
+std::optional<uint32_t> fenOrderKey(const std::string& fen) {
+    uint32_t pieces = 0, whiteKing = 0, blackKing = 0, whiteKings = 0, blackKings = 0;
+    int file = 0, rank = 7;
+
+    for (char c : fen) {
+        if (c == ' ') break;
+
+        if (c == '/') {
+            rank--;
+            file = 0;
+        } else if (c >= '1' && c <= '8') {
+            file += c - '0';
+        } else {
+            if (c == 'K') whiteKing = rank * 8 + file, ++whiteKings;
+            if (c == 'k') blackKing = rank * 8 + file, ++blackKings;
+            ++pieces;
+            ++file;
+        }
+    }
+
+    if (whiteKings != 1 || blackKings != 1 || whiteKing > 63 || blackKing > 63) return std::nullopt;
+
+    return pieces << 12 | whiteKing << 6 | blackKing;
+}
+
+} // namespace
+
+
+// Evaluates every FEN in a file, one per line, and writes each one followed by
+// its evaluation in centipawns from white's perspective. The file is read in
+// chunks, and each chunk is split between the search threads, each evaluating
+// its share in batches. Like a search, this runs on the threads of the pool, so
+// they stay bound to their CPUs and use the networks on their own node.
+void Engine::evalBatch(const std::string& input, const std::string& output) {
+    constexpr size_t BATCH_SIZE = 32;
+    constexpr size_t CHUNK_SIZE = 4096;
+
+    // Each thread reuses its positions and caches from one chunk to the next.
+    // They are allocated by the thread itself, so they live on its node.
+    struct Worker {
+        std::vector<std::unique_ptr<Position>> positions;
+        std::unique_ptr<NNUE::AccumulatorCaches> caches;
+    };
+
+    std::ifstream in(input);
+    if (!in) {
+        std::cout << "Error: could not open '" << input << "'" << std::endl;
+        return;
+    }
+
+    std::ofstream file;
+    if (!output.empty()) {
+        file.open(output);
+        if (!file) {
+            std::cout << "Error: could not open '" << output << "'" << std::endl;
+            return;
+        }
+    }
+    std::ostream& out = output.empty() ? std::cout : file;
+
+    waitForSearchFinish();
+    verifyNetworks();
+
+    std::vector<Worker> workers(threads.size());
+
+    std::vector<std::string> fens;
+    std::vector<uint32_t> order;
+    std::vector<int> scores;
+    std::vector<uint8_t> valid;
+    size_t evaluated = 0, invalid = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // Evaluates fens[begin, end) in batches
+    auto work = [&](Worker& worker, const NNUE::Networks& nets, size_t begin, size_t end) {
+        std::vector<const Position*> batch;
+        std::vector<size_t> indices;
+        Value values[BATCH_SIZE];
+
+        while (begin < end) {
+            batch.clear();
+            indices.clear();
+
+            for (; begin < end && batch.size() < BATCH_SIZE; ++begin) {
+                const size_t i = order[begin];
+                Position& pos = *worker.positions[batch.size()];
+                valid[i] = valid[i] && pos.setFromFEN(fens[i]);
+                if (!valid[i]) continue;
+
+                batch.push_back(&pos);
+                indices.push_back(i);
+            }
+
+            Eval::evaluateBatch(batch, nets, *worker.caches, values);
+
+            for (size_t j = 0; j < batch.size(); ++j) {
+                const Position& pos = *batch[j];
+                const Value v = pos.getSideToMove() == WHITE ? values[j] : -values[j];
+                scores[indices[j]] = Uci::toCentipawns(v, pos);
+            }
+        }
+    };
+
+    std::string line;
+    while (in) {
+        fens.clear();
+        while (fens.size() < CHUNK_SIZE && std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (!line.empty()) fens.push_back(line);
+        }
+
+        if (fens.empty()) break;
+
+        // Evaluate the chunk ordered by network layer stack and king squares,
+        // read straight from the FENs. Positions that share these need the
+        // fewest feature changes from one accumulator refresh to the next.
+        order.resize(fens.size());
+        valid.resize(fens.size());
+        std::vector<uint32_t> keys(fens.size());
+        for (uint32_t i = 0; i < fens.size(); ++i) {
+            const std::optional<uint32_t> key = fenOrderKey(fens[i]);
+            order[i] = i;
+            keys[i]  = key.value_or(0);
+            valid[i] = key.has_value();
+        }
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+
+        scores.assign(fens.size(), 0);
+
+        // Give each thread a contiguous share of the chunk
+        const size_t share = (fens.size() + workers.size() - 1) / workers.size();
+        threads.runTask([&](Thread& thread) {
+            const size_t begin = std::min(fens.size(), thread.id() * share);
+            const size_t end   = std::min(fens.size(), begin + share);
+            Worker& worker = workers[thread.id()];
+            const NNUE::Networks& nets = thread.worker->getNetworks();
+
+            if (!worker.caches) {
+                for (size_t i = 0; i < BATCH_SIZE; ++i)
+                    worker.positions.push_back(std::make_unique<Position>());
+                worker.caches = std::make_unique<NNUE::AccumulatorCaches>(nets);
+            }
+
+            work(worker, nets, begin, end);
+        });
+
+        for (size_t i = 0; i < fens.size(); ++i) {
+            if (valid[i]) {
+                out << fens[i] << " | " << scores[i] << "\n";
+                ++evaluated;
+            } else {
+                out << fens[i] << " | invalid\n";
+                ++invalid;
+            }
+        }
+        out.flush();
+    }
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Positions evaluated : " << evaluated << std::endl;
+    if (invalid)
+        std::cout << "Invalid FENs        : " << invalid << std::endl;
+    std::cout << "Threads             : " << workers.size() << std::endl;
+    std::cout << "Positions/second    : " << size_t(evaluated / std::max(elapsed, 1e-9)) << std::endl;
 }
 
 
@@ -89,17 +573,23 @@ void Engine::verifyNetworks() {
 }
 
 
-// Loads respective networks from file
+// Loads respective networks from file, either a .nnue file or a network cache
 // HACK: This assumes the names of the NNUE files themselves do not contain / or \.
+// The eval hash and accumulator caches of each thread hold outputs of the old
+// network, so they are cleared along with the rest of the thread state.
 void Engine::loadBigNetFromFile(const std::string& path) {
-    size_t n = path.find_last_of("/\\");
-    networks.big.load(path.substr(0, n), path.substr(n + 1));
-    networks.big.verify(EvalFileDefaultNameBig);
+    size_t n = path.find_last_of("/\\") + 1;
+    networks.big.load(path.substr(0, n), path.substr(n));
+    networks.big.verify(path.substr(n));
+    replicateNetworks(boundCpus());
+    threads.clearThreads();
 }
 void Engine::loadSmallNetFromFile(const std::string& path) {
-    size_t n = path.find_last_of("/\\");
-    networks.small.load(path.substr(0, n), path.substr(n + 1));
-    networks.small.verify(EvalFileDefaultNameSmall);
+    size_t n = path.find_last_of("/\\") + 1;
+    networks.small.load(path.substr(0, n), path.substr(n));
+    networks.small.verify(path.substr(n));
+    replicateNetworks(boundCpus());
+    threads.clearThreads();
 }
 
 //
@@ -109,6 +599,10 @@ void Engine::loadSmallNetFromFile(const std::string& path) {
 
 // UCI Go command. Starts searching at the current position.
 void Engine::go(Search::SearchLimits limits) {
+#ifdef SEARCH_STATS
+    benchStats.valid = false;
+#endif
+    limits.currMoveInterval = currMoveInterval;
     threads.go(pos, limits);
 }
 
@@ -119,6 +613,13 @@ void Engine::stop() {
 }
 
 
+// UCI ponderhit command. The opponent played the move we were pondering on,
+// so carry on searching normally.
+void Engine::ponderHit() {
+    threads.ponder = false;
+}
+
+
 // Traces the evaluation from the current position and shows the contributions
 // of various evaluation sources.
 void Engine::traceEval() {
@@ -139,6 +640,93 @@ void Engine::traceEval() {
 }
 
 
+// Recreates the search threads. The old ones are stopped first, as they may
+// use network replicas that are no longer needed with the new placement.
+void Engine::setNbThreads(size_t nbThreads) {
+    threads.setNbThreads(0, {threads, networks, tt});
+    replicateNetworks(Numa::plan(threads.getBinding(), nbThreads));
+    threads.setNbThreads(nbThreads, {threads, networks, tt, replicas});
+}
+
+
+std::vector<int> Engine::boundCpus() const {
+    std::vector<int> cpus;
+    for (auto it = threads.cbegin(); it != threads.cend(); ++it)
+        cpus.push_back((*it)->boundCpu());
+    return cpus;
+}
+
+
+// Gives each NUMA node that threads are bound to its own copy of the networks,
+// so that refreshes read the weights from local memory. Each copy is made by a
+// thread bound to the node, so that its memory is first touched there. Copies
+// are updated in place, as the workers hold references to them. Networks that
+// are mapped from a cache are shared rather than copied.
+void Engine::replicateNetworks(const std::vector<int>& cpus) {
+    std::vector<int> cpuOnNode(Numa::nbNodes(), -1);
+
+    if (cpuOnNode.size() > 1) {
+        for (int cpu : cpus) {
+            if (cpu >= 0) cpuOnNode[Numa::nodeOf(cpu)] = cpu;
+        }
+    }
+
+    replicas.resize(cpuOnNode.size());
+
+    for (size_t node = 0; node < cpuOnNode.size(); ++node) {
+        if (cpuOnNode[node] < 0) {
+            replicas[node].reset();
+            continue;
+        }
+
+        std::thread([&] {
+            Numa::bindThisThread(cpuOnNode[node]);
+
+            if (replicas[node]) *replicas[node] = networks;
+            else replicas[node] = std::make_unique<NNUE::Networks>(networks);
+        }).join();
+
+        const size_t size = replicas[node]->big.owned_size() + replicas[node]->small.owned_size();
+        std::cout << "info string NNUE networks replicated on node " << node << " ("
+                  << size / (1024 * 1024) << "MiB"
+                  << (networks.big.is_mapped() || networks.small.is_mapped() ? ", mapped networks shared" : "")
+                  << ")" << std::endl;
+    }
+}
+
+
+// Sets how the search threads are placed on CPUs, then recreates them so it takes effect.
+void Engine::setThreadBinding(const std::string& value) {
+    const std::optional<Numa::Binding> binding = Numa::parseBinding(value);
+
+    if (!binding) {
+        std::cout << "Error: thread binding must be none, compact, spread or a list of CPUs such as 0-7,16-23" << std::endl;
+        return;
+    }
+
+    threads.setBinding(*binding);
+    setNbThreads(threads.size());
+
+    if (binding->policy == Numa::BindPolicy::NONE) return;
+
+    std::vector<int> threadsOnNode(Numa::nbNodes());
+    size_t unbound = 0;
+
+    for (const std::unique_ptr<Thread>& thread : threads) {
+        if (thread->boundCpu() < 0) ++unbound;
+        else ++threadsOnNode[Numa::nodeOf(thread->boundCpu())];
+    }
+
+    std::cout << "info string Thread binding " << Numa::toString(*binding) << ":";
+    for (size_t node = 0; node < threadsOnNode.size(); ++node)
+        std::cout << (node ? ", " : " ") << threadsOnNode[node] << " threads on node " << node;
+    std::cout << std::endl;
+
+    if (unbound)
+        std::cout << "Error: " << unbound << " threads could not be bound" << std::endl;
+}
+
+
 void Engine::waitForSearchFinish() {
     threads.firstThread()->waitForFinish();
 }
@@ -146,7 +734,7 @@ void Engine::waitForSearchFinish() {
 
 void Engine::clear() {
     waitForSearchFinish();
-    tt.clear();
+    threads.clearTT(tt);
     threads.clearThreads();
 }
 
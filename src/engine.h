@@ -2,6 +2,8 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <string>
 #include <string_view>
 #include <vector>
 
@@ -14,6 +16,8 @@
 
 namespace Atom {
 
+constexpr TimePoint CURRMOVE_INTERVAL_DEFAULT = 1000;
+
 class Engine {
 public:
 
@@ -24,6 +28,10 @@ public:
 
     // Debugging
     void runPerft(int depth);
+    void runBench(int depth, size_t nbThreads, size_t hashSize);
+    void benchSetPosition(int plies);
+    void benchLatency(size_t nbThreads, int runs);
+    void printStats();
     std::string getDebugInfo();
     std::string getFen() const { return pos.fen(); }
 
@@ -39,17 +47,22 @@ public:
     void loadBigNetFromFile(const std::string& path);
     void loadSmallNetFromFile(const std::string& path);
     void verifyNetworks();
+    void convertNetwork(const std::string& input, const std::string& output);
+    void evalBatch(const std::string& input, const std::string& output);
 
     // Runs respective UCI commands
     void go(Search::SearchLimits limits);
     void stop();
+    void ponderHit();
     void traceEval();
     void newGame();
     void clear();
 
     // Set aspects of engine
-    inline void setHashSize(size_t newSize) { tt.resize(newSize); }
-    inline void setNbThreads(size_t nbThreads) { threads.setNbThreads(nbThreads, {threads, networks, tt}); }
+    inline void setHashSize(size_t newSize) { tt.resize(newSize); threads.clearTT(tt); }
+    void setNbThreads(size_t nbThreads);
+    inline void setCurrMoveInterval(TimePoint interval) { currMoveInterval = interval; }
+    void setThreadBinding(const std::string& value);
 
     // Search
     void waitForSearchFinish();
@@ -58,9 +71,34 @@ public:
 private:
     Position pos;
 
+    // The FEN and moves that pos was last set up from
+    std::string posFen;
+    std::vector<std::string> posMoves;
+
+    TimePoint currMoveInterval = CURRMOVE_INTERVAL_DEFAULT;
+
     ThreadPool threads;
     NNUE::Networks networks;
     TranspositionTable tt;
+
+    // Copies of the networks on each NUMA node threads are bound to, indexed by node.
+    // Only kept on machines with more than one node.
+    std::vector<std::unique_ptr<NNUE::Networks>> replicas;
+
+    void replicateNetworks(const std::vector<int>& cpus);
+    std::vector<int> boundCpus() const;
+
+#ifdef SEARCH_STATS
+    // Statistics summed over every position of the last bench. The bench
+    // recreates the threads when it ends, so printStats shows these until the
+    // next search.
+    struct BenchStats {
+        bool                valid = false;
+        size_t              nbThreads;
+        Search::SearchStats search;
+        NNUE::UpdateStats   big, small;
+    } benchStats;
+#endif
 };
 
 } // namespace Atom
@@ -0,0 +1,69 @@
+#include <vector>
+
+#include "evaluate.h"
+
+namespace Atom {
+
+namespace Eval {
+
+void evaluateBatch(
+    std::span<const Position* const> positions,
+    const NNUE::Networks& networks,
+    NNUE::AccumulatorCaches& cacheTables,
+    Value* results
+) {
+    const size_t n = positions.size();
+
+    std::vector<Value>               pvEval(n);
+    std::vector<NnueOutput>          outputs(n);
+    std::vector<NNUE::NetworkOutput> netOutputs(n);
+
+    // Split the positions between the networks the same way nnueOutput does
+    std::vector<const Position*> small, big;
+    std::vector<size_t>          smallIdx, bigIdx;
+
+    for (size_t i = 0; i < n; ++i) {
+        const Position& pos = *positions[i];
+        pvEval[i] = pos.getSideToMove() == WHITE ? pieceValueEval<WHITE>(pos) : pieceValueEval<BLACK>(pos);
+
+        if (abs(pvEval[i]) > Tunables::NNUE_SMALL_NET_THRESHOLD) {
+            small.push_back(&pos);
+            smallIdx.push_back(i);
+        } else {
+            big.push_back(&pos);
+            bigIdx.push_back(i);
+        }
+    }
+
+    networks.small.evaluate_batch(small, &cacheTables.small, netOutputs.data());
+
+    for (size_t j = 0; j < small.size(); ++j) {
+        const size_t i = smallIdx[j];
+        const auto [psqt, positional] = netOutputs[j];
+        const Value nnueEval = blendNnue(psqt, positional);
+
+        if (pvEval[i] * nnueEval < 0 || std::abs(nnueEval) < Tunables::NNUE_RE_EVALUATE_THRESHOLD) {
+            big.push_back(small[j]);
+            bigIdx.push_back(i);
+        } else {
+            outputs[i] = {psqt, positional, true};
+        }
+    }
+
+    networks.big.evaluate_batch(big, &cacheTables.big, netOutputs.data());
+
+    for (size_t j = 0; j < big.size(); ++j) {
+        const auto [psqt, positional] = netOutputs[j];
+        outputs[bigIdx[j]] = {psqt, positional, false};
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        const Position& pos = *positions[i];
+        results[i] = pos.getSideToMove() == WHITE ? evaluate<WHITE>(pos, outputs[i], 0)
+                                                  : evaluate<BLACK>(pos, outputs[i], 0);
+    }
+}
+
+} // namespace Eval
+
+} // namespace Atom
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
 
 #include "nnue/network.h"
 #include "nnue/nnue_accumulator.h"
@@ -47,20 +50,26 @@ inline Value totalMaterial(const Position& pos, bool smallNet) {
 }
 
 
-// Full evaluation function
+// The raw output of the networks for a position, before it is blended
+// with optimism and material.
+struct NnueOutput {
+    Value psqt, positional;
+    bool  smallNet;
+};
+
+
+// Runs the network suited to the position: the small net when one side is far
+// ahead in material, unless it disagrees with the material balance.
 template <Color Me>
-Value evaluate(
+NnueOutput nnueOutput(
     const Position& pos,
     const NNUE::Networks& networks,
-    NNUE::AccumulatorCaches& cacheTables,
-    Value optimism
+    NNUE::AccumulatorCaches& cacheTables
 ) {
-    // Positions where we are in check should not be evaluated: qsearch should search deeper.
-    assert(!pos.checkers());
-
     // Get evaluation from various sources
     const Value pvEval = pieceValueEval<Me>(pos);
     bool smallNet = abs(pvEval) > Tunables::NNUE_SMALL_NET_THRESHOLD;
+    (smallNet ? cacheTables.small.stats : cacheTables.big.stats).count_evaluation();
     auto [psqt, positional] = smallNet
                             ? networks.small.evaluate(pos, &cacheTables.small)
                             : networks.big.evaluate(pos, &cacheTables.big);
@@ -72,10 +81,67 @@ Value evaluate(
     // re-evaluate it with the big network
     if (smallNet && (pvEval * nnueEval < 0 || std::abs(nnueEval) < Tunables::NNUE_RE_EVALUATE_THRESHOLD)) {
         std::tie(psqt, positional) = networks.big.evaluate(pos, &cacheTables.big);
-        nnueEval = blendNnue(psqt, positional);
         smallNet = false;
+        cacheTables.small.stats.count_re_evaluation();
+        cacheTables.big.stats.count_evaluation();
+    }
+
+    return {psqt, positional, smallNet};
+}
+
+
+// A small hash table of network outputs, one per search thread.
+// The TT only keeps an eval while its entry survives, and qsearch visits many
+// of the same positions again each iteration, so this saves a lot of network
+// evaluations. The network output depends only on the pieces and the side to
+// move, so it is stored before optimism and the fifty move rule are applied.
+class EvalHash {
+public:
+    static constexpr size_t SIZE = 1 << 16;
+    static_assert((SIZE & (SIZE - 1)) == 0, "SIZE must be a power of 2");
+
+    // Returns the entry for key, or nullptr if the table does not have it
+    inline const NnueOutput* probe(Key key) {
+        ++probes;
+        const Entry& entry = table[key & (SIZE - 1)];
+        if (entry.key32 != uint32_t(key >> 32)) return nullptr;
+        ++hits;
+        return &entry.output;
+    }
+
+    inline void store(Key key, const NnueOutput& output) {
+        table[key & (SIZE - 1)] = {uint32_t(key >> 32), output};
     }
 
+    inline void clear() {
+        table.fill({});
+        resetCounters();
+    }
+
+    inline void resetCounters() { probes = hits = 0; }
+
+    uint64_t probes = 0, hits = 0;
+
+private:
+    struct Entry {
+        uint32_t   key32;
+        NnueOutput output;
+    };
+
+    std::array<Entry, SIZE> table;
+};
+
+
+// Full evaluation function, from the output of the networks
+template <Color Me>
+Value evaluate(
+    const Position& pos,
+    const NnueOutput& output,
+    Value optimism
+) {
+    const auto [psqt, positional, smallNet] = output;
+    Value nnueEval = blendNnue(psqt, positional);
+
     // Calculate complexity and subtract from eval
     Value complexity = std::abs(psqt - positional);
     nnueEval -= nnueEval * complexity / (smallNet ? Tunables::NNUE_COMPLEXITY_SMALL : Tunables::NNUE_COMPLEXITY_BIG);
@@ -100,6 +166,55 @@ Value evaluate(
 }
 
 
+// Full evaluation function
+template <Color Me>
+Value evaluate(
+    const Position& pos,
+    const NNUE::Networks& networks,
+    NNUE::AccumulatorCaches& cacheTables,
+    Value optimism
+) {
+    // Positions where we are in check should not be evaluated: qsearch should search deeper.
+    assert(!pos.checkers());
+
+    return evaluate<Me>(pos, nnueOutput<Me>(pos, networks, cacheTables), optimism);
+}
+
+
+// Full evaluation function, reusing the network output from evalHash if it has one
+template <Color Me>
+Value evaluate(
+    const Position& pos,
+    const NNUE::Networks& networks,
+    NNUE::AccumulatorCaches& cacheTables,
+    EvalHash& evalHash,
+    Value optimism
+) {
+    assert(!pos.checkers());
+
+    if (const NnueOutput* output = evalHash.probe(pos.hash())) {
+        return evaluate<Me>(pos, *output, optimism);
+    }
+
+    const NnueOutput output = nnueOutput<Me>(pos, networks, cacheTables);
+    evalHash.store(pos.hash(), output);
+
+    return evaluate<Me>(pos, output, optimism);
+}
+
+
+// Evaluates many positions at once, as evaluate would with no optimism, writing
+// results[i] for positions[i]. Each network evaluates its share of the positions
+// ordered to make accumulator refreshes cheap, which is much faster than
+// evaluating them one by one in any order.
+void evaluateBatch(
+    std::span<const Position* const> positions,
+    const NNUE::Networks& networks,
+    NNUE::AccumulatorCaches& cacheTables,
+    Value* results
+);
+
+
 } // namespace Eval
 
 } // namespace Atom
@@ -1,4 +1,5 @@
 #include <cstdlib>
+#include <string>
 
 #include "bitboard.h"
 #include "uci.h"
@@ -36,6 +37,18 @@ int main (int argc, char *argv[]) {
     std::cout << " built " << __DATE__ << " " << __TIME__ << std::endl;
 
     Uci uci;
+
+    // Run any command given on the command line (e.g. "atom bench") and exit
+    if (argc > 1) {
+        std::string command;
+        for (int i = 1; i < argc; ++i) {
+            command += std::string(argv[i]) + " ";
+        }
+
+        uci.execute(command);
+        return EXIT_SUCCESS;
+    }
+
     uci.loop();
 
     return EXIT_SUCCESS;
@@ -1,8 +1,13 @@
 #include "memory.h"
 
 #include <cstdlib>
+#include <fstream>
+#include <sstream>
 
+#include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace Atom {
 
@@ -29,4 +34,47 @@ void* aligned_large_pages_alloc(size_t allocSize) {
 
 void aligned_large_pages_free(void* mem) { std_aligned_free(mem); }
 
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    void* mem = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+
+    if (mem == MAP_FAILED) return nullptr;
+
+    return std::shared_ptr<MappedFile>(new MappedFile(mem, size_t(st.st_size)));
+}
+
+
+MappedFile::~MappedFile() {
+    munmap(mem, length);
+}
+
+
+MemoryUsage memoryUsage() {
+    MemoryUsage usage;
+
+    std::ifstream status("/proc/self/status");
+    std::string line, key;
+    size_t kb;
+
+    while (std::getline(status, line)) {
+        std::istringstream(line) >> key >> kb;
+        if (key == "RssAnon:") usage.anon = kb * 1024;
+        if (key == "RssFile:") usage.file = kb * 1024;
+    }
+
+    return usage;
+}
+
 } // namespace Atom
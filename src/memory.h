@@ -3,6 +3,7 @@
 #include "types.h"
 #include <cassert>
 #include <memory>
+#include <string>
 
 namespace Atom {
 
@@ -166,4 +167,35 @@ std::enable_if_t<std::is_array_v<T>, AlignedPtr<T>> make_unique_aligned(size_t n
     return AlignedPtr<T>(memory);
 }
 
+
+// A whole file mapped read-only into memory. The pages are shared with every
+// other process mapping the same file, and only read in when touched.
+class MappedFile {
+public:
+    // Returns nullptr if the file cannot be mapped
+    static std::shared_ptr<MappedFile> open(const std::string& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    const char* data() const { return static_cast<const char*>(mem); }
+    size_t      size() const { return length; }
+
+private:
+    MappedFile(void* mem, size_t length) : mem(mem), length(length) {}
+
+    void*  mem;
+    size_t length;
+};
+
+
+// Resident memory of this process, in bytes: private (anonymous) memory,
+// and memory backed by files such as mapped networks.
+struct MemoryUsage {
+    size_t anon = 0, file = 0;
+};
+
+MemoryUsage memoryUsage();
+
 } // namespace Atom
@@ -0,0 +1,296 @@
+// Microbenchmarks for the hot components of the engine, each timed on its
+// own over the bench positions. Build and run with "make microbench".
+//
+// Usage: atom-microbench [filter]
+// Only components whose name contains filter are run.
+//
+// Every component is first calibrated so that one sample takes at least
+// SAMPLE_NS, then warmed up, then timed REPETITIONS times. The mean,
+// standard deviation and minimum time per operation are reported.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../bench.h"
+#include "../bitboard.h"
+#include "../movegen.h"
+#include "../movepicker.h"
+#include "../nnue.h"
+#include "../nnue/network.h"
+#include "../nnue/nnue_accumulator.h"
+#include "../nnue/nnue_feature_transformer.h"
+#include "../position.h"
+#include "../tt.h"
+#include "../types.h"
+#include "../zobrist.h"
+
+using namespace Atom;
+
+namespace {
+
+constexpr int      WARMUP_RUNS = 2;
+constexpr int      REPETITIONS = 15;
+constexpr uint64_t SAMPLE_NS   = 20'000'000;
+
+// Results are added here so the compiler cannot remove the work being timed
+volatile uint64_t sink;
+
+std::vector<std::unique_ptr<Position>> corpus;
+
+
+// Times fn(iterations), which returns the number of operations it performed.
+template<typename Fn>
+void run(const std::string& name, const std::string& filter, Fn&& fn) {
+    using namespace std::chrono;
+
+    if (name.find(filter) == std::string::npos) return;
+
+    auto timeOnce = [&](uint64_t iterations, uint64_t& ops) {
+        auto start = steady_clock::now();
+        ops = fn(iterations);
+        return uint64_t(duration_cast<nanoseconds>(steady_clock::now() - start).count());
+    };
+
+    // Calibrate
+    uint64_t iterations = 1, ops;
+    while (timeOnce(iterations, ops) < SAMPLE_NS) iterations *= 2;
+
+    for (int i = 0; i < WARMUP_RUNS; ++i) timeOnce(iterations, ops);
+
+    std::vector<double> samples;
+    for (int i = 0; i < REPETITIONS; ++i) {
+        const uint64_t ns = timeOnce(iterations, ops);
+        samples.push_back(double(ns) / ops);
+    }
+
+    double mean = 0, variance = 0;
+    for (double s : samples) mean += s;
+    mean /= samples.size();
+    for (double s : samples) variance += (s - mean) * (s - mean);
+    variance /= samples.size() - 1;
+
+    const double stddev = std::sqrt(variance);
+    const double min    = *std::min_element(samples.begin(), samples.end());
+
+    std::printf("%-28s %12.2f %10.2f %7.2f%% %12.2f\n",
+                name.c_str(), mean, stddev, 100 * stddev / mean, min);
+}
+
+
+MoveList legalMoves(const Position& pos) {
+    MoveList moves;
+    Movegen::enumerateLegalMoves(pos, [&](Move m) {
+        moves.push_back(m);
+        return true;
+    });
+
+    return moves;
+}
+
+
+int bucketOf(const Position& pos) {
+    return (popcount(pos.getPiecesBB()) - 1) / 4;
+}
+
+} // namespace
+
+
+int main(int argc, char* argv[]) {
+    initBBs();
+    Zobrist::init();
+
+    const std::string filter = argc > 1 ? argv[1] : "";
+
+    for (const std::string& fen : Bench::POSITIONS) {
+        corpus.push_back(std::make_unique<Position>());
+        corpus.back()->setFromFEN(fen);
+    }
+
+    std::vector<MoveList> moves;
+    for (const auto& pos : corpus) moves.push_back(legalMoves(*pos));
+
+    std::printf("%zu positions, %d repetitions\n\n", corpus.size(), REPETITIONS);
+    std::printf("%-28s %12s %10s %8s %12s\n", "component", "ns/op", "stddev", "cv", "min ns/op");
+
+
+    run("doMove/undoMove", filter, [&](uint64_t iterations) {
+        uint64_t ops = 0;
+        for (uint64_t it = 0; it < iterations; ++it) {
+            for (size_t i = 0; i < corpus.size(); ++i) {
+                Position& pos = *corpus[i];
+                for (Move m : moves[i]) {
+                    pos.doMove(m);
+                    sink = sink + pos.hash();
+                    pos.undoMove(m);
+                }
+                ops += moves[i].size();
+            }
+        }
+        return ops;
+    });
+
+
+    run("enumerateLegalMoves", filter, [&](uint64_t iterations) {
+        uint64_t ops = 0, count = 0;
+        for (uint64_t it = 0; it < iterations; ++it) {
+            for (const auto& pos : corpus) {
+                Movegen::enumerateLegalMoves(*pos, [&](Move m) {
+                    count += m;
+                    return true;
+                });
+                ++ops;
+            }
+        }
+        sink = sink + count;
+        return ops;
+    });
+
+
+    {
+        auto butterflyHist    = std::make_unique<Movepicker::ButterflyHistory>();
+        auto captureHist      = std::make_unique<Movepicker::CapturePieceToHistory>();
+        auto continuationHist = std::make_unique<Movepicker::ContinuationHistory>();
+        auto pawnHist         = std::make_unique<Movepicker::PawnHistory>();
+
+        butterflyHist->fill(0);
+        captureHist->fill(0);
+        for (auto& to : *continuationHist)
+            for (auto& h : to)
+                h->fill(0);
+        pawnHist->fill(0);
+
+        const Movepicker::PieceToHistory* ch = &(*continuationHist)[NO_PIECE][0];
+        const Movepicker::PieceToHistory* contHist[] = {ch, ch, ch, ch, nullptr, ch};
+
+        auto drain = [&]<Color Me>(const Position& pos) {
+            Movepicker::MovePicker<Me> mp(pos, MOVE_NONE, MOVE_NONE, 8,
+                                          butterflyHist.get(), captureHist.get(),
+                                          contHist, pawnHist.get());
+            uint64_t n = 0;
+            for (Move m; (m = mp.nextMove()) != MOVE_NONE; ++n) {
+                sink = sink + m;
+            }
+            return n;
+        };
+
+        run("MovePicker::nextMove", filter, [&](uint64_t iterations) {
+            uint64_t ops = 0;
+            for (uint64_t it = 0; it < iterations; ++it) {
+                for (const auto& pos : corpus) {
+                    ops += pos->getSideToMove() == WHITE
+                         ? drain.template operator()<WHITE>(*pos)
+                         : drain.template operator()<BLACK>(*pos);
+                }
+            }
+            return ops;
+        });
+    }
+
+
+    run("Position::see", filter, [&](uint64_t iterations) {
+        uint64_t ops = 0, count = 0;
+        for (uint64_t it = 0; it < iterations; ++it) {
+            for (size_t i = 0; i < corpus.size(); ++i) {
+                for (Move m : moves[i]) {
+                    count += corpus[i]->see(m, 0);
+                }
+                ops += moves[i].size();
+            }
+        }
+        sink = sink + count;
+        return ops;
+    });
+
+
+    {
+        TranspositionTable tt(16);
+
+        // Random keys, so most probes miss the cache as they would in search
+        std::vector<Key> keys(1 << 16);
+        Key k = 0x9E3779B97F4A7C15ull;
+        for (Key& key : keys) key = (k ^= k << 13, k ^= k >> 7, k ^= k << 17);
+
+        run("TranspositionTable::probe", filter, [&](uint64_t iterations) {
+            uint64_t ops = 0, count = 0;
+            for (uint64_t it = 0; it < iterations; ++it) {
+                for (Key key : keys) {
+                    auto [ttHit, ttData, ttWriter] = tt.probe(key);
+                    count += ttHit + ttData.depth;
+                }
+                ops += keys.size();
+            }
+            sink = sink + count;
+            return ops;
+        });
+    }
+
+
+    {
+        NNUE::Networks networks(
+            NNUE::NetworkBig({EvalFileDefaultNameBig, "None", ""}, NNUE::EmbeddedNNUEType::BIG),
+            NNUE::NetworkSmall({EvalFileDefaultNameSmall, "None", ""}, NNUE::EmbeddedNNUEType::SMALL)
+        );
+        networks.big.load("<internal>", EvalFileDefaultNameBig);
+        networks.small.load("<internal>", EvalFileDefaultNameSmall);
+
+        auto caches = std::make_unique<NNUE::AccumulatorCaches>(networks);
+
+        // The transformer's weights do not affect its speed, so a zeroed one
+        // stands in for the (private) transformer inside the network. It uses
+        // the kernels of the instruction set this file is built for.
+        using BigFeatureTransformer = NNUE::NNUE_KERNELS::BigFeatureTransformer;
+        auto transformer = std::make_unique<BigFeatureTransformer>();
+        alignas(64) static BigFeatureTransformer::OutputType output[BigFeatureTransformer::BufferSize];
+
+        // The accumulators are computed on the first call, so this measures
+        // the transform itself rather than accumulator updates.
+        run("FeatureTransformer::transform", filter, [&](uint64_t iterations) {
+            uint64_t ops = 0;
+            for (uint64_t it = 0; it < iterations; ++it) {
+                for (const auto& pos : corpus) {
+                    sink = sink + transformer->transform(*pos, &caches->big, output, bucketOf(*pos));
+                    ++ops;
+                }
+            }
+            return ops;
+        });
+
+        // The transformer above shares the positions' accumulators, so start
+        // again from fresh positions.
+        for (size_t i = 0; i < corpus.size(); ++i) {
+            corpus[i]->setFromFEN(Bench::POSITIONS[i]);
+        }
+
+        run("Network::evaluate (big)", filter, [&](uint64_t iterations) {
+            uint64_t ops = 0;
+            for (uint64_t it = 0; it < iterations; ++it) {
+                for (const auto& pos : corpus) {
+                    auto [psqt, positional] = networks.big.evaluate(*pos, &caches->big);
+                    sink = sink + psqt + positional;
+                    ++ops;
+                }
+            }
+            return ops;
+        });
+
+        run("Network::evaluate (small)", filter, [&](uint64_t iterations) {
+            uint64_t ops = 0;
+            for (uint64_t it = 0; it < iterations; ++it) {
+                for (const auto& pos : corpus) {
+                    auto [psqt, positional] = networks.small.evaluate(*pos, &caches->small);
+                    sink = sink + psqt + positional;
+                    ++ops;
+                }
+            }
+            return ops;
+        });
+    }
+
+    return 0;
+}
@@ -160,12 +160,14 @@ top:
         case MovePickStage::MP_STAGE_TT:
         case MovePickStage::MP_STAGE_EVASION_TT:
         case MovePickStage::MP_STAGE_QSEARCH_ALL_TT:
+        case MovePickStage::MP_STAGE_PROBCUT_TT:
             ++mpStage;
             return ttMove;
 
         // Generate all moves for stage
         case MovePickStage::MP_STAGE_CAPTURE_GENERATE:
         case MovePickStage::MP_STAGE_QSEARCH_CAP_GENERATE:
+        case MovePickStage::MP_STAGE_PROBCUT_GENERATE:
             current  = endBadCaptures = movelist;
             endMoves = Movegen::enumerateLegalMovesToList<Me, Movegen::MG_TYPE_TACTICAL>(pos, current);
 
@@ -267,6 +269,10 @@ top:
         case MovePickStage::MP_STAGE_QSEARCH_CAP_GOOD:
             // Return next move if it isn't in the TT
             return MovePicker<Me>::select([]() { return true; }).move;
+
+        // Captures that do not win enough material are left out altogether
+        case MovePickStage::MP_STAGE_PROBCUT_GOOD:
+            return MovePicker<Me>::select([&]() { return pos.see(current->move, threshold); }).move;
     }
 
     // Should never reach this point.
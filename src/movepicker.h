@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <cassert>
 #include <cstdint>
 
 #include "position.h"
@@ -100,6 +102,10 @@ enum class MovePickStage : uint32_t {
     MP_STAGE_QSEARCH_ALL_TT,
     MP_STAGE_QSEARCH_CAP_GENERATE,
     MP_STAGE_QSEARCH_CAP_GOOD,
+
+    MP_STAGE_PROBCUT_TT,
+    MP_STAGE_PROBCUT_GENERATE,
+    MP_STAGE_PROBCUT_GOOD,
 };
 
 
@@ -155,6 +161,22 @@ public:
         mpStage = determineStage(pos.inCheck(), ttMove, depth);
     }
 
+    // ProbCut: only the captures that win at least threshold by SEE
+    MovePicker(
+        const Position& pos,
+        Move  ttMove,
+        int   threshold,
+        const CapturePieceToHistory* cph
+    ) :
+        pos(pos), ttMove(ttMove), killer(MOVE_NONE), depth(0), threshold(threshold),
+        butterflyHist(nullptr), captureHist(cph), continuationHist(nullptr), pawnHist(nullptr)
+    {
+        assert(!pos.inCheck());
+
+        mpStage = MovePickStage::MP_STAGE_PROBCUT_TT
+                + !(ttMove && pos.isTactical(ttMove) && pos.isPseudoLegalMove<Me>(ttMove) && pos.see(ttMove, threshold));
+    }
+
     // MovePicker cannot be copied
     MovePicker(const MovePicker &)            = delete;
     MovePicker(MovePicker &&)                 = delete;
@@ -167,6 +189,7 @@ private:
     const Position& pos;
     Move            ttMove, killer;
     Depth           depth;
+    int             threshold = 0;
     MovePickStage   mpStage;
     ScoredMove      movelist[MAX_MOVE];
     ScoredMove      *current, *endMoves, *endBadCaptures, *beginBadQuiets, *endBadQuiets;
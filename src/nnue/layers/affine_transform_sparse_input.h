@@ -23,6 +23,7 @@
 
 #include <algorithm>
 #include <array>
+#include <bit>
 #include <cstdint>
 #include <iostream>
 
@@ -35,17 +36,19 @@
   This file contains the definition for a fully connected layer (aka affine transform) with block sparse input.
 */
 
-namespace Atom::NNUE::Layers {
+namespace Atom::NNUE::NNUE_KERNELS::Layers {
 
 #if (USE_SSSE3 | (USE_NEON >= 8))
-alignas(CacheLineSize) static inline const
+// Built at compile time: a static initializer in this namespace could be
+// compiled with instructions the CPU lacks, and would run at startup anyway.
+alignas(CacheLineSize) static constexpr
   std::array<std::array<std::uint16_t, 8>, 256> lookup_indices = []() {
       std::array<std::array<std::uint16_t, 8>, 256> v{};
       for (unsigned i = 0; i < 256; ++i)
       {
           std::uint64_t j = i, k = 0;
-          while (j)
-              v[i][k++] = pop_lsb(j);
+          for (; j; j &= j - 1)
+              v[i][k++] = std::countr_zero(j);
       }
       return v;
   }();
@@ -273,6 +276,6 @@ class AffineTransformSparseInput {
     alignas(CacheLineSize) WeightType weights[OutputDimensions * PaddedInputDimensions];
 };
 
-}  // namespace Atom::NNUE::Layers
+}  // namespace Atom::NNUE::NNUE_KERNELS::Layers
 
 #endif  // #ifndef NNUE_LAYERS_AFFINE_TRANSFORM_SPARSE_INPUT_H_INCLUDED
@@ -27,7 +27,7 @@
 
 #include "../nnue_common.h"
 
-namespace Atom::NNUE::Layers {
+namespace Atom::NNUE::NNUE_KERNELS::Layers {
 
 // Clipped ReLU
 template<IndexType InDims>
@@ -159,6 +159,6 @@ class ClippedReLU {
     }
 };
 
-}  // namespace Atom::NNUE::Layers
+}  // namespace Atom::NNUE::NNUE_KERNELS::Layers
 
 #endif  // NNUE_LAYERS_CLIPPED_RELU_H_INCLUDED
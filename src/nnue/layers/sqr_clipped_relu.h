@@ -27,7 +27,7 @@
 
 #include "../nnue_common.h"
 
-namespace Atom::NNUE::Layers {
+namespace Atom::NNUE::NNUE_KERNELS::Layers {
 
 // Clipped ReLU
 template<IndexType InDims>
@@ -98,6 +98,6 @@ public:
     }
 };
 
-}  // namespace Atom::NNUE::Layers
+}  // namespace Atom::NNUE::NNUE_KERNELS::Layers
 
 #endif  // NNUE_LAYERS_SQR_CLIPPED_RELU_H_INCLUDED
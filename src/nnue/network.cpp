@@ -18,20 +18,21 @@
 
 #include "network.h"
 
+#include <algorithm>
+#include <cassert>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <optional>
-#include <type_traits>
 #include <vector>
 
+#include "../cpu.h"
 #include "../incbin/incbin.h"
-#include "../memory.h"
 #include "../nnue.h"
 #include "../position.h"
 #include "../types.h"
-#include "nnue_architecture.h"
+#include "features/half_ka_v2_hm.h"
 #include "nnue_common.h"
 #include "nnue_misc.h"
 
@@ -82,68 +83,64 @@ EmbeddedNNUE get_embedded(EmbeddedNNUEType type) {
 namespace Atom::NNUE {
 
 
-namespace Detail {
-
-// Read evaluation function parameters
-template<typename T>
-bool read_parameters(std::istream& stream, T& reference) {
+namespace {
 
-    std::uint32_t header;
-    header = read_little_endian<std::uint32_t>(stream);
-    if (!stream || header != T::get_hash_value())
-        return false;
-    return reference.read_parameters(stream);
+// The kernels built into the binary, one set per instruction set
+std::vector<KernelSet>& kernel_sets() {
+    static std::vector<KernelSet> sets;
+    return sets;
 }
 
-// Write evaluation function parameters
-template<typename T>
-bool write_parameters(std::ostream& stream, const T& reference) {
+}  // namespace
 
-    write_little_endian<std::uint32_t>(stream, T::get_hash_value());
-    return reference.write_parameters(stream);
+bool register_kernels(const KernelSet& kernelSet) {
+    kernel_sets().push_back(kernelSet);
+    return true;
 }
 
-}  // namespace Detail
-
-template<typename Arch, typename Transformer>
-Network<Arch, Transformer>::Network(const Network<Arch, Transformer>& other) :
-    evalFile(other.evalFile),
-    embeddedType(other.embeddedType) {
+// The kernels are always built for the instruction set of the rest of the
+// engine too, so there is a set the CPU supports if the engine runs at all.
+const KernelSet& kernel_set() {
+    static const KernelSet& selected = []() -> const KernelSet& {
+        const KernelSet* best = nullptr;
+        for (const auto& kernelSet : kernel_sets())
+            if (kernelSet.isa <= Cpu::hostIsa() && (!best || kernelSet.isa > best->isa))
+                best = &kernelSet;
 
-    if (other.featureTransformer)
-        featureTransformer = make_unique_large_page<Transformer>(*other.featureTransformer);
+        assert(best);
+        return *best;
+    }();
 
-    network = make_unique_aligned<Arch[]>(LayerStacks);
+    return selected;
+}
 
-    if (!other.network)
-        return;
 
-    for (std::size_t i = 0; i < LayerStacks; ++i)
-        network[i] = other.network[i];
+template<IndexType L1, int L2, int L3>
+Network<L1, L2, L3>::Network(EvalFile file, EmbeddedNNUEType type) :
+    evalFile(file),
+    embeddedType(type) {
+    if constexpr (L1 == TransformedFeatureDimensionsBig)
+        kernels = kernel_set().make_big();
+    else
+        kernels = kernel_set().make_small();
 }
 
-template<typename Arch, typename Transformer>
-Network<Arch, Transformer>&
-Network<Arch, Transformer>::operator=(const Network<Arch, Transformer>& other) {
+template<IndexType L1, int L2, int L3>
+Network<L1, L2, L3>::Network(const Network<L1, L2, L3>& other) :
+    kernels(other.kernels->clone()),
+    evalFile(other.evalFile),
+    embeddedType(other.embeddedType) {}
+
+template<IndexType L1, int L2, int L3>
+Network<L1, L2, L3>& Network<L1, L2, L3>::operator=(const Network<L1, L2, L3>& other) {
+    kernels      = other.kernels->clone();
     evalFile     = other.evalFile;
     embeddedType = other.embeddedType;
-
-    if (other.featureTransformer)
-        featureTransformer = make_unique_large_page<Transformer>(*other.featureTransformer);
-
-    network = make_unique_aligned<Arch[]>(LayerStacks);
-
-    if (!other.network)
-        return *this;
-
-    for (std::size_t i = 0; i < LayerStacks; ++i)
-        network[i] = other.network[i];
-
     return *this;
 }
 
-template<typename Arch, typename Transformer>
-void Network<Arch, Transformer>::load(const std::string& rootDirectory, std::string evalfilePath) {
+template<IndexType L1, int L2, int L3>
+void Network<L1, L2, L3>::load(const std::string& rootDirectory, std::string evalfilePath) {
 #if defined(DEFAULT_NNUE_DIRECTORY)
     std::vector<std::string> dirs = {"<internal>", "", rootDirectory,
         stringify(DEFAULT_NNUE_DIRECTORY)};
@@ -172,8 +169,8 @@ void Network<Arch, Transformer>::load(const std::string& rootDirectory, std::str
 }
 
 
-template<typename Arch, typename Transformer>
-bool Network<Arch, Transformer>::save(const std::optional<std::string>& filename) const {
+template<IndexType L1, int L2, int L3>
+bool Network<L1, L2, L3>::save(const std::optional<std::string>& filename) const {
     std::string actualFilename;
     std::string msg;
 
@@ -203,37 +200,14 @@ bool Network<Arch, Transformer>::save(const std::optional<std::string>& filename
 }
 
 
-template<typename Arch, typename Transformer>
-NetworkOutput
-Network<Arch, Transformer>::evaluate(const Position&                         pos,
-                                     AccumulatorCaches::Cache<FTDimensions>* cache) const {
-    // We manually align the arrays on the stack because with gcc < 9.3
-    // overaligning stack variables with alignas() doesn't work correctly.
-
-    constexpr uint64_t alignment = CacheLineSize;
-
-#if defined(ALIGNAS_ON_STACK_VARIABLES_BROKEN)
-    TransformedFeatureType
-    transformedFeaturesUnaligned[FeatureTransformer<FTDimensions, nullptr>::BufferSize
-    + alignment / sizeof(TransformedFeatureType)];
-
-    auto* transformedFeatures = align_ptr_up<alignment>(&transformedFeaturesUnaligned[0]);
-#else
-    alignas(alignment) TransformedFeatureType
-    transformedFeatures[FeatureTransformer<FTDimensions, nullptr>::BufferSize];
-#endif
-
-    ASSERT_ALIGNED(transformedFeatures, alignment);
-
-    const int  bucket     = (pos.nPieces() - 1) / 4;
-    const auto psqt       = featureTransformer->transform(pos, cache, transformedFeatures, bucket);
-    const auto positional = network[bucket].propagate(transformedFeatures);
-    return {static_cast<Value>(psqt / OutputScale), static_cast<Value>(positional / OutputScale)};
+template<IndexType L1, int L2, int L3>
+bool Network<L1, L2, L3>::save_cache(const std::string& filename) const {
+    return kernels->save_cache(filename, evalFile.netDescription);
 }
 
 
-template<typename Arch, typename Transformer>
-void Network<Arch, Transformer>::verify(std::string evalfilePath) const {
+template<IndexType L1, int L2, int L3>
+void Network<L1, L2, L3>::verify(std::string evalfilePath) const {
     if (evalfilePath.empty())
         evalfilePath = evalFile.defaultName;
 
@@ -257,62 +231,34 @@ void Network<Arch, Transformer>::verify(std::string evalfilePath) const {
         exit(EXIT_FAILURE);
     }
 
-    size_t size = sizeof(*featureTransformer) + sizeof(Arch) * LayerStacks;
+    size_t size = kernels->size();
     std::cout << "info string NNUE evaluation using " << evalfilePath << " ("
-        << size / (1024 * 1024) << "MiB, (" << featureTransformer->InputDimensions << ", "
-        << network[0].TransformedFeatureDimensions << ", " << network[0].FC_0_OUTPUTS << ", "
-        << network[0].FC_1_OUTPUTS << ", 1))" << std::endl;
+        << size / (1024 * 1024) << "MiB, (" << Features::HalfKAv2_hm::Dimensions << ", "
+        << L1 << ", " << L2 << ", " << L3 << ", 1))" << (kernels->is_mapped() ? " mapped" : "")
+        << std::endl;
 }
 
 
-template<typename Arch, typename Transformer>
-void Network<Arch, Transformer>::hint_common_access(
-    const Position& pos, AccumulatorCaches::Cache<FTDimensions>* cache) const {
-    featureTransformer->hint_common_access(pos, cache);
-}
-
-template<typename Arch, typename Transformer>
-NnueEvalTrace
-Network<Arch, Transformer>::trace_evaluate(const Position&                         pos,
-                                           AccumulatorCaches::Cache<FTDimensions>* cache) const {
-    // We manually align the arrays on the stack because with gcc < 9.3
-    // overaligning stack variables with alignas() doesn't work correctly.
-    constexpr uint64_t alignment = CacheLineSize;
-
-#if defined(ALIGNAS_ON_STACK_VARIABLES_BROKEN)
-    TransformedFeatureType
-    transformedFeaturesUnaligned[FeatureTransformer<FTDimensions, nullptr>::BufferSize
-    + alignment / sizeof(TransformedFeatureType)];
+template<IndexType L1, int L2, int L3>
+void Network<L1, L2, L3>::load_user_net(const std::string& dir,
+                                        const std::string& evalfilePath) {
+    std::ifstream stream(dir + evalfilePath, std::ios::binary);
 
-    auto* transformedFeatures = align_ptr_up<alignment>(&transformedFeaturesUnaligned[0]);
-#else
-    alignas(alignment) TransformedFeatureType
-    transformedFeatures[FeatureTransformer<FTDimensions, nullptr>::BufferSize];
-#endif
+    // Network cache files are mapped rather than read
+    char magic[sizeof(CacheMagic)] = {};
+    stream.read(magic, sizeof(magic));
+    stream.seekg(0);
 
-    ASSERT_ALIGNED(transformedFeatures, alignment);
+    std::optional<std::string> description;
+    std::string                cachedDescription;
 
-    NnueEvalTrace t{};
-    t.correctBucket = (pos.nPieces() - 1) / 4;
-    for (IndexType bucket = 0; bucket < LayerStacks; ++bucket)
+    if (std::equal(magic, magic + sizeof(magic), CacheMagic))
     {
-        const auto materialist =
-            featureTransformer->transform(pos, cache, transformedFeatures, bucket);
-        const auto positional = network[bucket].propagate(transformedFeatures);
-
-        t.psqt[bucket]       = static_cast<Value>(materialist / OutputScale);
-        t.positional[bucket] = static_cast<Value>(positional / OutputScale);
+        if (kernels->load_cache(dir + evalfilePath, cachedDescription))
+            description = cachedDescription;
     }
-
-    return t;
-}
-
-
-template<typename Arch, typename Transformer>
-void Network<Arch, Transformer>::load_user_net(const std::string& dir,
-                                               const std::string& evalfilePath) {
-    std::ifstream stream(dir + evalfilePath, std::ios::binary);
-    auto          description = load(stream);
+    else
+        description = kernels->load(stream);
 
     if (description.has_value())
     {
@@ -322,8 +268,8 @@ void Network<Arch, Transformer>::load_user_net(const std::string& dir,
 }
 
 
-template<typename Arch, typename Transformer>
-void Network<Arch, Transformer>::load_internal() {
+template<IndexType L1, int L2, int L3>
+void Network<L1, L2, L3>::load_internal() {
     // C++ way to prepare a buffer for a memory stream
     class MemoryBuffer: public std::basic_streambuf<char> {
     public:
@@ -339,7 +285,7 @@ void Network<Arch, Transformer>::load_internal() {
                         size_t(embedded.size));
 
     std::istream stream(&buffer);
-    auto         description = load(stream);
+    auto         description = kernels->load(stream);
 
     if (description.has_value())
     {
@@ -349,106 +295,20 @@ void Network<Arch, Transformer>::load_internal() {
 }
 
 
-template<typename Arch, typename Transformer>
-void Network<Arch, Transformer>::initialize() {
-    featureTransformer = make_unique_large_page<Transformer>();
-    network            = make_unique_aligned<Arch[]>(LayerStacks);
-}
-
-
-template<typename Arch, typename Transformer>
-bool Network<Arch, Transformer>::save(std::ostream&      stream,
-                                      const std::string& name,
-                                      const std::string& netDescription) const {
+template<IndexType L1, int L2, int L3>
+bool Network<L1, L2, L3>::save(std::ostream&      stream,
+                               const std::string& name,
+                               const std::string& netDescription) const {
     if (name.empty() || name == "None")
         return false;
 
-    return write_parameters(stream, netDescription);
+    return kernels->save(stream, netDescription);
 }
 
 
-template<typename Arch, typename Transformer>
-std::optional<std::string> Network<Arch, Transformer>::load(std::istream& stream) {
-    initialize();
-    std::string description;
-
-    return read_parameters(stream, description) ? std::make_optional(description) : std::nullopt;
-}
-
-
-// Read network header
-template<typename Arch, typename Transformer>
-bool Network<Arch, Transformer>::read_header(std::istream&  stream,
-                                             std::uint32_t* hashValue,
-                                             std::string*   desc) const {
-    std::uint32_t version, size;
-
-    version    = read_little_endian<std::uint32_t>(stream);
-    *hashValue = read_little_endian<std::uint32_t>(stream);
-    size       = read_little_endian<std::uint32_t>(stream);
-    if (!stream || version != Version)
-        return false;
-    desc->resize(size);
-    stream.read(&(*desc)[0], size);
-    return !stream.fail();
-}
-
-
-// Write network header
-template<typename Arch, typename Transformer>
-bool Network<Arch, Transformer>::write_header(std::ostream&      stream,
-                                              std::uint32_t      hashValue,
-                                              const std::string& desc) const {
-    write_little_endian<std::uint32_t>(stream, Version);
-    write_little_endian<std::uint32_t>(stream, hashValue);
-    write_little_endian<std::uint32_t>(stream, std::uint32_t(desc.size()));
-    stream.write(&desc[0], desc.size());
-    return !stream.fail();
-}
-
-
-template<typename Arch, typename Transformer>
-bool Network<Arch, Transformer>::read_parameters(std::istream& stream,
-                                                 std::string&  netDescription) const {
-    std::uint32_t hashValue;
-    if (!read_header(stream, &hashValue, &netDescription))
-        return false;
-    if (hashValue != Network::hash)
-        return false;
-    if (!Detail::read_parameters(stream, *featureTransformer))
-        return false;
-    for (std::size_t i = 0; i < LayerStacks; ++i)
-    {
-        if (!Detail::read_parameters(stream, network[i]))
-            return false;
-    }
-    return stream && stream.peek() == std::ios::traits_type::eof();
-}
-
-
-template<typename Arch, typename Transformer>
-bool Network<Arch, Transformer>::write_parameters(std::ostream&      stream,
-                                                  const std::string& netDescription) const {
-    if (!write_header(stream, Network::hash, netDescription))
-        return false;
-    if (!Detail::write_parameters(stream, *featureTransformer))
-        return false;
-    for (std::size_t i = 0; i < LayerStacks; ++i)
-    {
-        if (!Detail::write_parameters(stream, network[i]))
-            return false;
-    }
-    return bool(stream);
-}
-
 // Explicit template instantiation
 
-template class Network<
-NetworkArchitecture<TransformedFeatureDimensionsBig, L2Big, L3Big>,
-FeatureTransformer<TransformedFeatureDimensionsBig, &BoardState::accumulatorBig>>;
-
-template class Network<
-NetworkArchitecture<TransformedFeatureDimensionsSmall, L2Small, L3Small>,
-FeatureTransformer<TransformedFeatureDimensionsSmall, &BoardState::accumulatorSmall>>;
+template class Network<TransformedFeatureDimensionsBig, L2Big, L3Big>;
+template class Network<TransformedFeatureDimensionsSmall, L2Small, L3Small>;
 
 }  // namespace Atom::NNUE
@@ -19,19 +19,21 @@
 #ifndef NETWORK_H_INCLUDED
 #define NETWORK_H_INCLUDED
 
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
+#include <memory>
 #include <optional>
+#include <span>
 #include <string>
 #include <tuple>
 #include <utility>
 
-#include "../memory.h"
+#include "../cpu.h"
 #include "../position.h"
 #include "../types.h"
 #include "nnue_accumulator.h"
-#include "nnue_architecture.h"
-#include "nnue_feature_transformer.h"
+#include "nnue_common.h"
 #include "nnue_misc.h"
 
 namespace Atom::NNUE {
@@ -43,14 +45,62 @@ enum class EmbeddedNNUEType {
 
 using NetworkOutput = std::tuple<Value, Value>;
 
-template<typename Arch, typename Transformer>
+// Network cache files start with this, see network_kernels.cpp
+constexpr char CacheMagic[8] = {'A', 'T', 'O', 'M', 'N', 'N', 'C', '1'};
+
+// The parameters of a network, laid out for the NNUE kernels of one
+// instruction set, and those kernels. network_kernels.cpp implements it once
+// for each instruction set the kernels are built for (see the Makefile).
+template<IndexType L1, int L2, int L3>
+class NetworkKernels {
+   public:
+    virtual ~NetworkKernels() = default;
+
+    virtual std::unique_ptr<NetworkKernels> clone() const = 0;
+
+    // Reads the parameters from a .nnue file, returning its description
+    virtual std::optional<std::string> load(std::istream& stream) = 0;
+    virtual bool save(std::ostream& stream, const std::string& netDescription) const = 0;
+
+    // Maps the parameters from a network cache file, or writes one. See
+    // network_kernels.cpp for the format.
+    virtual bool load_cache(const std::string& filename, std::string& netDescription) = 0;
+    virtual bool save_cache(const std::string& filename, const std::string& netDescription) const = 0;
+
+    virtual bool            is_mapped() const  = 0;
+    virtual std::size_t     size() const       = 0;
+    virtual std::size_t     owned_size() const = 0;
+    virtual const BiasType* biases() const     = 0;
+
+    virtual NetworkOutput evaluate(const Position& pos, AccumulatorCaches::Cache<L1>* cache) const = 0;
+    virtual void          evaluate_batch(std::span<const Position* const> positions,
+                                         AccumulatorCaches::Cache<L1>*    cache,
+                                         NetworkOutput*                   outputs) const = 0;
+    virtual void hint_common_access(const Position& pos, AccumulatorCaches::Cache<L1>* cache) const = 0;
+    virtual NnueEvalTrace trace_evaluate(const Position& pos, AccumulatorCaches::Cache<L1>* cache) const = 0;
+};
+
+using NetworkKernelsBig   = NetworkKernels<TransformedFeatureDimensionsBig, L2Big, L3Big>;
+using NetworkKernelsSmall = NetworkKernels<TransformedFeatureDimensionsSmall, L2Small, L3Small>;
+
+// The kernels of one instruction set. Each build of network_kernels.cpp
+// registers its own before main runs, and the networks use those of the newest
+// instruction set the CPU supports.
+struct KernelSet {
+    Cpu::Isa isa;
+    std::unique_ptr<NetworkKernelsBig> (*make_big)();
+    std::unique_ptr<NetworkKernelsSmall> (*make_small)();
+};
+
+bool             register_kernels(const KernelSet& kernelSet);
+const KernelSet& kernel_set();
+
+template<IndexType L1, int L2, int L3>
 class Network {
-    static constexpr IndexType FTDimensions = Arch::TransformedFeatureDimensions;
+    using Kernels = NetworkKernels<L1, L2, L3>;
 
 public:
-    Network(EvalFile file, EmbeddedNNUEType type) :
-        evalFile(file),
-        embeddedType(type) {}
+    Network(EvalFile file, EmbeddedNNUEType type);
 
     Network(const Network& other);
     Network(Network&& other) = default;
@@ -61,61 +111,58 @@ public:
     void load(const std::string& rootDirectory, std::string evalfilePath);
     bool save(const std::optional<std::string>& filename) const;
 
-    NetworkOutput evaluate(const Position&                         pos,
-                           AccumulatorCaches::Cache<FTDimensions>* cache) const;
+    // Writes the parameters as they are laid out in memory, ready to be mapped
+    // by load. See network_kernels.cpp for the format.
+    bool save_cache(const std::string& filename) const;
 
+    bool is_loaded(const std::string& evalfilePath) const { return evalFile.current == evalfilePath; }
+    bool is_mapped() const { return kernels->is_mapped(); }
 
-    void hint_common_access(const Position&                         pos,
-                            AccumulatorCaches::Cache<FTDimensions>* cache) const;
+    // The memory the parameters take up, not counting a mapping, which copies share
+    size_t owned_size() const { return kernels->owned_size(); }
 
-    void          verify(std::string evalfilePath) const;
-    NnueEvalTrace trace_evaluate(const Position&                         pos,
-                                 AccumulatorCaches::Cache<FTDimensions>* cache) const;
+    NetworkOutput evaluate(const Position& pos, AccumulatorCaches::Cache<L1>* cache) const {
+        return kernels->evaluate(pos, cache);
+    }
 
-private:
-    void load_user_net(const std::string&, const std::string&);
-    void load_internal();
+    // Evaluates many positions, writing outputs[i] for positions[i]. Gives the
+    // same results as evaluate, but visits the positions in the order that
+    // makes accumulator refreshes cheapest, which is faster for large batches.
+    void evaluate_batch(std::span<const Position* const> positions,
+                        AccumulatorCaches::Cache<L1>*    cache,
+                        NetworkOutput*                   outputs) const {
+        kernels->evaluate_batch(positions, cache, outputs);
+    }
 
-    void initialize();
 
-    bool                       save(std::ostream&, const std::string&, const std::string&) const;
-    std::optional<std::string> load(std::istream&);
+    void hint_common_access(const Position& pos, AccumulatorCaches::Cache<L1>* cache) const {
+        kernels->hint_common_access(pos, cache);
+    }
 
-    bool read_header(std::istream&, std::uint32_t*, std::string*) const;
-    bool write_header(std::ostream&, std::uint32_t, const std::string&) const;
+    void          verify(std::string evalfilePath) const;
+    NnueEvalTrace trace_evaluate(const Position& pos, AccumulatorCaches::Cache<L1>* cache) const {
+        return kernels->trace_evaluate(pos, cache);
+    }
 
-    bool read_parameters(std::istream&, std::string&) const;
-    bool write_parameters(std::ostream&, const std::string&) const;
+private:
+    void load_user_net(const std::string&, const std::string&);
+    void load_internal();
 
-    // Input feature converter
-    LargePagePtr<Transformer> featureTransformer;
+    bool save(std::ostream&, const std::string&, const std::string&) const;
 
-    // Evaluation function
-    AlignedPtr<Arch[]> network;
+    // The parameters and the kernels evaluating them, for the instruction set
+    // picked at startup
+    std::unique_ptr<Kernels> kernels;
 
     EvalFile         evalFile;
     EmbeddedNNUEType embeddedType;
 
-    // Hash value of evaluation function structure
-    static constexpr std::uint32_t hash = Transformer::get_hash_value() ^ Arch::get_hash_value();
-
     template<IndexType Size>
     friend struct AccumulatorCaches::Cache;
 };
 
-// Definitions of the network types
-using SmallFeatureTransformer =
-FeatureTransformer<TransformedFeatureDimensionsSmall, &BoardState::accumulatorSmall>;
-using SmallNetworkArchitecture =
-NetworkArchitecture<TransformedFeatureDimensionsSmall, L2Small, L3Small>;
-
-using BigFeatureTransformer =
-FeatureTransformer<TransformedFeatureDimensionsBig, &BoardState::accumulatorBig>;
-using BigNetworkArchitecture =
-NetworkArchitecture<TransformedFeatureDimensionsBig, L2Big, L3Big>;
-
-using NetworkBig   = Network<BigNetworkArchitecture, BigFeatureTransformer>;
-using NetworkSmall = Network<SmallNetworkArchitecture, SmallFeatureTransformer>;
+using NetworkBig   = Network<TransformedFeatureDimensionsBig, L2Big, L3Big>;
+using NetworkSmall = Network<TransformedFeatureDimensionsSmall, L2Small, L3Small>;
 
 
 struct Networks {
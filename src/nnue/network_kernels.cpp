@@ -0,0 +1,535 @@
+/*
+  Stockfish, a UCI chess playing engine derived from Glaurung 2.1
+  Copyright (C) 2004-2024 The Stockfish developers (see AUTHORS file)
+
+  Stockfish is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Stockfish is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// The NNUE kernels of one instruction set. The Makefile compiles this file
+// once for each instruction set in NNUE_ISAS, with the USE_* macros of that
+// instruction set, and each build registers its kernels with the networks.
+
+#include "network.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iosfwd>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../bitboard.h"
+#include "../cpu.h"
+#include "../memory.h"
+#include "../position.h"
+#include "../trace.h"
+#include "../types.h"
+#include "features/half_ka_v2_hm.h"
+#include "nnue_accumulator.h"
+#include "nnue_common.h"
+#include "nnue_misc.h"
+
+// Everything from here to the pop_options is compiled for this instruction
+// set, whatever the -m flags of the rest of the engine, and only runs on CPUs
+// that support it. All the headers the kernels use are included above, so
+// that the code they share with the rest of the engine is compiled as usual:
+// an inline function compiled here could otherwise end up being the one the
+// whole binary uses.
+#pragma GCC push_options
+#if defined(USE_VNNI)
+    #pragma GCC target("avx2,popcnt,bmi,bmi2,avx512f,avx512bw,avx512dq,avx512vl,avx512vnni,prefer-vector-width=512")
+#elif defined(USE_AVX512)
+    #pragma GCC target("avx2,popcnt,bmi,bmi2,avx512f,avx512bw,avx512dq")
+#elif defined(USE_BMI2)
+    #pragma GCC target("avx2,popcnt,bmi,bmi2")
+#elif defined(USE_AVX2)
+    #pragma GCC target("avx2,popcnt")
+#elif defined(USE_SSE41)
+    #pragma GCC target("sse4.2,popcnt")
+#endif
+
+#include "nnue_architecture.h"
+#include "nnue_feature_transformer.h"
+
+namespace Atom::NNUE::NNUE_KERNELS {
+
+
+namespace Detail {
+
+// Read evaluation function parameters
+template<typename T>
+bool read_parameters(std::istream& stream, T& reference) {
+
+    std::uint32_t header;
+    header = read_little_endian<std::uint32_t>(stream);
+    if (!stream || header != T::get_hash_value())
+        return false;
+    return reference.read_parameters(stream);
+}
+
+// Write evaluation function parameters
+template<typename T>
+bool write_parameters(std::ostream& stream, const T& reference) {
+
+    write_little_endian<std::uint32_t>(stream, T::get_hash_value());
+    return reference.write_parameters(stream);
+}
+
+// Network cache files hold the parameters exactly as they are laid out in
+// memory once loaded, i.e. already permuted and scaled for the SIMD
+// instructions of the kernels, so they can be mapped instead of parsed. This
+// also lets every process on a machine share a single copy of the net.
+// The layout is: CacheHeader, the net description, the feature transformer
+// and then the layer stacks, each of the last two starting on a page.
+constexpr std::size_t CacheAlignment = 4096;
+
+struct CacheHeader {
+    char          magic[8];
+    std::uint32_t version;  // Of the .nnue format
+    std::uint32_t hash;     // Of the network architecture
+    std::uint32_t isa;      // The parameter layout depends on the SIMD instructions
+    std::uint32_t layerStacks;
+    std::uint64_t transformerOffset, transformerSize;
+    std::uint64_t layersOffset, layersSize;
+    std::uint32_t descriptionSize;
+};
+
+inline std::uint64_t align_to_page(std::uint64_t offset) {
+    return (offset + CacheAlignment - 1) / CacheAlignment * CacheAlignment;
+}
+
+}  // namespace Detail
+
+
+template<typename Arch, typename Transformer>
+class Kernels final:
+    public NetworkKernels<Arch::TransformedFeatureDimensions, Arch::FC_0_OUTPUTS, Arch::FC_1_OUTPUTS> {
+    static constexpr IndexType FTDimensions = Arch::TransformedFeatureDimensions;
+
+    using Base = NetworkKernels<FTDimensions, Arch::FC_0_OUTPUTS, Arch::FC_1_OUTPUTS>;
+
+   public:
+    Kernels() = default;
+    Kernels(const Kernels& other);
+
+    std::unique_ptr<Base> clone() const override { return std::make_unique<Kernels>(*this); }
+
+    std::optional<std::string> load(std::istream& stream) override;
+    bool save(std::ostream& stream, const std::string& netDescription) const override;
+
+    bool load_cache(const std::string& filename, std::string& netDescription) override;
+    bool save_cache(const std::string& filename, const std::string& netDescription) const override;
+
+    bool is_mapped() const override { return bool(mapping); }
+
+    std::size_t size() const override { return sizeof(Transformer) + sizeof(Arch) * LayerStacks; }
+
+    std::size_t owned_size() const override {
+        return (featureTransformer ? sizeof(Transformer) : 0) + (network ? sizeof(Arch) * LayerStacks : 0);
+    }
+
+    const BiasType* biases() const override { return transformer->get_biases(); }
+
+    NetworkOutput evaluate(const Position&                         pos,
+                           AccumulatorCaches::Cache<FTDimensions>* cache) const override;
+
+    void evaluate_batch(std::span<const Position* const>        positions,
+                        AccumulatorCaches::Cache<FTDimensions>* cache,
+                        NetworkOutput*                          outputs) const override;
+
+    void hint_common_access(const Position&                         pos,
+                            AccumulatorCaches::Cache<FTDimensions>* cache) const override {
+        transformer->hint_common_access(pos, cache);
+    }
+
+    NnueEvalTrace trace_evaluate(const Position&                         pos,
+                                 AccumulatorCaches::Cache<FTDimensions>* cache) const override;
+
+   private:
+    void initialize();
+
+    bool read_header(std::istream&, std::uint32_t*, std::string*) const;
+    bool write_header(std::ostream&, std::uint32_t, const std::string&) const;
+
+    bool read_parameters(std::istream&, std::string&) const;
+    bool write_parameters(std::ostream&, const std::string&) const;
+
+    // Input feature converter
+    LargePagePtr<Transformer> featureTransformer;
+
+    // Evaluation function
+    AlignedPtr<Arch[]> network;
+
+    // A network cache file the parameters are read from instead, if one was loaded
+    std::shared_ptr<MappedFile> mapping;
+
+    // The parameters evaluation uses: either the two above, or the mapping
+    const Transformer* transformer = nullptr;
+    const Arch*        layers      = nullptr;
+
+    // Hash value of evaluation function structure
+    static constexpr std::uint32_t hash = Transformer::get_hash_value() ^ Arch::get_hash_value();
+};
+
+
+template<typename Arch, typename Transformer>
+Kernels<Arch, Transformer>::Kernels(const Kernels<Arch, Transformer>& other) {
+    // A mapped network is read only, so copies can share it
+    if (other.mapping)
+    {
+        mapping     = other.mapping;
+        transformer = other.transformer;
+        layers      = other.layers;
+        return;
+    }
+
+    if (other.featureTransformer)
+        featureTransformer = make_unique_large_page<Transformer>(*other.featureTransformer);
+
+    network = make_unique_aligned<Arch[]>(LayerStacks);
+
+    transformer = featureTransformer.get();
+    layers      = network.get();
+
+    if (!other.network)
+        return;
+
+    for (std::size_t i = 0; i < LayerStacks; ++i)
+        network[i] = other.network[i];
+}
+
+
+template<typename Arch, typename Transformer>
+NetworkOutput
+Kernels<Arch, Transformer>::evaluate(const Position&                         pos,
+                                     AccumulatorCaches::Cache<FTDimensions>* cache) const {
+    TRACE_SCOPE("Network::evaluate");
+
+    // We manually align the arrays on the stack because with gcc < 9.3
+    // overaligning stack variables with alignas() doesn't work correctly.
+
+    constexpr uint64_t alignment = CacheLineSize;
+
+#if defined(ALIGNAS_ON_STACK_VARIABLES_BROKEN)
+    TransformedFeatureType
+    transformedFeaturesUnaligned[FeatureTransformer<FTDimensions, nullptr>::BufferSize
+    + alignment / sizeof(TransformedFeatureType)];
+
+    auto* transformedFeatures = align_ptr_up<alignment>(&transformedFeaturesUnaligned[0]);
+#else
+    alignas(alignment) TransformedFeatureType
+    transformedFeatures[FeatureTransformer<FTDimensions, nullptr>::BufferSize];
+#endif
+
+    ASSERT_ALIGNED(transformedFeatures, alignment);
+
+    const int  bucket     = (pos.nPieces() - 1) / 4;
+    const auto psqt       = transformer->transform(pos, cache, transformedFeatures, bucket);
+    const auto positional = layers[bucket].propagate(transformedFeatures);
+    return {static_cast<Value>(psqt / OutputScale), static_cast<Value>(positional / OutputScale)};
+}
+
+
+template<typename Arch, typename Transformer>
+void Kernels<Arch, Transformer>::evaluate_batch(std::span<const Position* const>        positions,
+                                                AccumulatorCaches::Cache<FTDimensions>* cache,
+                                                NetworkOutput*                          outputs) const {
+    TRACE_SCOPE("Network::evaluate_batch");
+
+    const auto bucket_of = [](const Position* pos) { return (pos->nPieces() - 1) / 4; };
+
+    // Visit the positions by layer stack, and within a layer stack by king
+    // squares: consecutive refreshes then start from the same accumulator cache
+    // entries, and positions with the same number of pieces tend to differ by
+    // fewer features.
+    std::vector<std::uint32_t> order(positions.size());
+    for (std::uint32_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+
+    const auto key = [&](std::uint32_t i) {
+        const Position* pos = positions[i];
+        return bucket_of(pos) << 12 | pos->getKingSquare(WHITE) << 6 | pos->getKingSquare(BLACK);
+    };
+    std::stable_sort(order.begin(), order.end(),
+                     [&](std::uint32_t a, std::uint32_t b) { return key(a) < key(b); });
+
+    // Each position is still propagated on its own: the layer stacks are small
+    // enough to stay in cache, so sharing their weights between positions
+    // measured as no faster.
+    for (std::uint32_t i : order)
+        outputs[i] = evaluate(*positions[i], cache);
+}
+
+
+template<typename Arch, typename Transformer>
+NnueEvalTrace
+Kernels<Arch, Transformer>::trace_evaluate(const Position&                         pos,
+                                           AccumulatorCaches::Cache<FTDimensions>* cache) const {
+    // We manually align the arrays on the stack because with gcc < 9.3
+    // overaligning stack variables with alignas() doesn't work correctly.
+    constexpr uint64_t alignment = CacheLineSize;
+
+#if defined(ALIGNAS_ON_STACK_VARIABLES_BROKEN)
+    TransformedFeatureType
+    transformedFeaturesUnaligned[FeatureTransformer<FTDimensions, nullptr>::BufferSize
+    + alignment / sizeof(TransformedFeatureType)];
+
+    auto* transformedFeatures = align_ptr_up<alignment>(&transformedFeaturesUnaligned[0]);
+#else
+    alignas(alignment) TransformedFeatureType
+    transformedFeatures[FeatureTransformer<FTDimensions, nullptr>::BufferSize];
+#endif
+
+    ASSERT_ALIGNED(transformedFeatures, alignment);
+
+    NnueEvalTrace t{};
+    t.correctBucket = (pos.nPieces() - 1) / 4;
+    for (IndexType bucket = 0; bucket < LayerStacks; ++bucket)
+    {
+        const auto materialist =
+            transformer->transform(pos, cache, transformedFeatures, bucket);
+        const auto positional = layers[bucket].propagate(transformedFeatures);
+
+        t.psqt[bucket]       = static_cast<Value>(materialist / OutputScale);
+        t.positional[bucket] = static_cast<Value>(positional / OutputScale);
+    }
+
+    return t;
+}
+
+
+template<typename Arch, typename Transformer>
+void Kernels<Arch, Transformer>::initialize() {
+    mapping.reset();
+    featureTransformer = make_unique_large_page<Transformer>();
+    network            = make_unique_aligned<Arch[]>(LayerStacks);
+    transformer        = featureTransformer.get();
+    layers             = network.get();
+}
+
+
+template<typename Arch, typename Transformer>
+bool Kernels<Arch, Transformer>::save_cache(const std::string& filename,
+                                            const std::string& netDescription) const {
+    static_assert(std::is_trivially_copyable_v<Transformer> && std::is_trivially_copyable_v<Arch>,
+                  "The parameters are written to the cache as they are in memory");
+
+    if (!transformer)
+        return false;
+
+    Detail::CacheHeader header{};
+    std::copy(std::begin(CacheMagic), std::end(CacheMagic), header.magic);
+    header.version           = Version;
+    header.hash              = hash;
+    header.isa               = Cpu::CompiledIsa;
+    header.layerStacks       = LayerStacks;
+    header.descriptionSize   = std::uint32_t(netDescription.size());
+    header.transformerOffset = Detail::align_to_page(sizeof(header) + header.descriptionSize);
+    header.transformerSize   = sizeof(Transformer);
+    header.layersOffset      = Detail::align_to_page(header.transformerOffset + header.transformerSize);
+    header.layersSize        = sizeof(Arch) * LayerStacks;
+
+    // The target may be mapped by this or another process, and truncating a
+    // mapped file makes the next read through the mapping fault. So the cache
+    // is written to a temporary file next to it, then renamed over it: those
+    // mappings keep the old file, and new ones get the new file.
+    const std::string tmpFilename = filename + ".tmp" + std::to_string(getpid());
+
+    std::ofstream stream(tmpFilename, std::ios::binary);
+
+    auto pad_to = [&](std::uint64_t offset) {
+        while (std::uint64_t(stream.tellp()) < offset)
+            stream.put(0);
+    };
+
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(netDescription.data(), header.descriptionSize);
+    pad_to(header.transformerOffset);
+    stream.write(reinterpret_cast<const char*>(transformer), header.transformerSize);
+    pad_to(header.layersOffset);
+    stream.write(reinterpret_cast<const char*>(layers), header.layersSize);
+    stream.close();
+
+    if (!stream || std::rename(tmpFilename.c_str(), filename.c_str()) != 0)
+    {
+        std::remove(tmpFilename.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+template<typename Arch, typename Transformer>
+bool Kernels<Arch, Transformer>::load_cache(const std::string& filename,
+                                            std::string&       netDescription) {
+    auto file = MappedFile::open(filename);
+    if (!file || file->size() < sizeof(Detail::CacheHeader))
+        return false;
+
+    Detail::CacheHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+
+    // The cache must have been written with the same network and SIMD layout
+    if (!std::equal(std::begin(CacheMagic), std::end(CacheMagic), header.magic)
+        || header.version != Version || header.hash != hash
+        || header.isa != std::uint32_t(Cpu::CompiledIsa) || header.layerStacks != LayerStacks
+        || header.transformerSize != sizeof(Transformer)
+        || header.layersSize != sizeof(Arch) * LayerStacks
+        || header.transformerOffset % CacheLineSize || header.layersOffset % CacheLineSize
+        || sizeof(header) + header.descriptionSize > header.transformerOffset
+        || header.transformerOffset + header.transformerSize > header.layersOffset
+        || header.layersOffset + header.layersSize > file->size())
+    {
+        std::cout << "info string Network cache " << filename
+                  << " does not match the " << Cpu::isaName(Cpu::CompiledIsa)
+                  << " kernels this CPU uses, convert the net again" << std::endl;
+        return false;
+    }
+
+    netDescription.assign(file->data() + sizeof(header), header.descriptionSize);
+
+    featureTransformer.reset();
+    network.reset();
+    mapping     = file;
+    transformer = reinterpret_cast<const Transformer*>(file->data() + header.transformerOffset);
+    layers      = reinterpret_cast<const Arch*>(file->data() + header.layersOffset);
+
+    return true;
+}
+
+
+template<typename Arch, typename Transformer>
+std::optional<std::string> Kernels<Arch, Transformer>::load(std::istream& stream) {
+    initialize();
+    std::string description;
+
+    return read_parameters(stream, description) ? std::make_optional(description) : std::nullopt;
+}
+
+
+template<typename Arch, typename Transformer>
+bool Kernels<Arch, Transformer>::save(std::ostream&      stream,
+                                      const std::string& netDescription) const {
+    return write_parameters(stream, netDescription);
+}
+
+
+// Read network header
+template<typename Arch, typename Transformer>
+bool Kernels<Arch, Transformer>::read_header(std::istream&  stream,
+                                             std::uint32_t* hashValue,
+                                             std::string*   desc) const {
+    std::uint32_t version, size;
+
+    version    = read_little_endian<std::uint32_t>(stream);
+    *hashValue = read_little_endian<std::uint32_t>(stream);
+    size       = read_little_endian<std::uint32_t>(stream);
+    if (!stream || version != Version)
+        return false;
+    desc->resize(size);
+    stream.read(&(*desc)[0], size);
+    return !stream.fail();
+}
+
+
+// Write network header
+template<typename Arch, typename Transformer>
+bool Kernels<Arch, Transformer>::write_header(std::ostream&      stream,
+                                              std::uint32_t      hashValue,
+                                              const std::string& desc) const {
+    write_little_endian<std::uint32_t>(stream, Version);
+    write_little_endian<std::uint32_t>(stream, hashValue);
+    write_little_endian<std::uint32_t>(stream, std::uint32_t(desc.size()));
+    stream.write(&desc[0], desc.size());
+    return !stream.fail();
+}
+
+
+template<typename Arch, typename Transformer>
+bool Kernels<Arch, Transformer>::read_parameters(std::istream& stream,
+                                                 std::string&  netDescription) const {
+    std::uint32_t hashValue;
+    if (!read_header(stream, &hashValue, &netDescription))
+        return false;
+    if (hashValue != hash)
+        return false;
+    if (!Detail::read_parameters(stream, *featureTransformer))
+        return false;
+    for (std::size_t i = 0; i < LayerStacks; ++i)
+    {
+        if (!Detail::read_parameters(stream, network[i]))
+            return false;
+    }
+    return stream && stream.peek() == std::ios::traits_type::eof();
+}
+
+
+template<typename Arch, typename Transformer>
+bool Kernels<Arch, Transformer>::write_parameters(std::ostream&      stream,
+                                                  const std::string& netDescription) const {
+    if (!write_header(stream, hash, netDescription))
+        return false;
+
+    // Writing undoes the permutation in place for a moment, which a read only
+    // mapping does not allow, so write mapped parameters from a copy.
+    LargePagePtr<Transformer> copy;
+    if (mapping)
+        copy = make_unique_large_page<Transformer>(*transformer);
+
+    if (!Detail::write_parameters(stream, mapping ? *copy : *featureTransformer))
+        return false;
+    for (std::size_t i = 0; i < LayerStacks; ++i)
+    {
+        if (!Detail::write_parameters(stream, layers[i]))
+            return false;
+    }
+    return bool(stream);
+}
+
+
+std::unique_ptr<NetworkKernelsBig> make_big() {
+    return std::make_unique<Kernels<BigNetworkArchitecture, BigFeatureTransformer>>();
+}
+
+std::unique_ptr<NetworkKernelsSmall> make_small() {
+    return std::make_unique<Kernels<SmallNetworkArchitecture, SmallFeatureTransformer>>();
+}
+
+}  // namespace Atom::NNUE::NNUE_KERNELS
+
+#pragma GCC pop_options
+
+
+namespace {
+
+// Runs before main on any CPU, so it must not be compiled for this instruction set
+const bool KernelsRegistered = Atom::NNUE::register_kernels(
+  {Atom::Cpu::CompiledIsa, Atom::NNUE::NNUE_KERNELS::make_big, Atom::NNUE::NNUE_KERNELS::make_small});
+
+}
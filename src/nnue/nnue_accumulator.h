@@ -21,9 +21,14 @@
 #ifndef NNUE_ACCUMULATOR_H_INCLUDED
 #define NNUE_ACCUMULATOR_H_INCLUDED
 
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 
-#include "nnue_architecture.h"
+#include "../types.h"
 #include "nnue_common.h"
 
 namespace Atom::NNUE {
@@ -41,6 +46,67 @@ struct alignas(CacheLineSize) Accumulator {
 };
 
 
+// Counters of how the accumulators of one network are brought up to date,
+// kept per thread alongside its cache. They are only counted with
+// -DSEARCH_STATS (see "make stats"); otherwise the count functions do nothing.
+struct UpdateStats {
+    // Refresh sizes are binned by powers of 2: 0, 1, 2-3, 4-7, ..., 64+
+    static constexpr int RefreshBins = 8;
+
+    std::uint64_t evaluations;        // Calls to the network from Eval
+    std::uint64_t reEvaluations;      // Small net results overruled by the big net
+    std::uint64_t upToDate;           // Perspectives already computed when needed
+    std::uint64_t incremental;        // Perspectives updated from an earlier accumulator
+    std::uint64_t incrementalStates;  // Accumulators computed by those updates
+    std::uint64_t fused;              // Updates over several plies with features cancelling out
+    std::uint64_t refreshes;          // Perspectives refreshed from the cache entry
+    std::uint64_t refreshChanges;     // Features added or removed by those refreshes
+    std::uint64_t refreshSizes[RefreshBins];
+
+    void clear() { *this = {}; }
+
+    void add(const UpdateStats& other) {
+        evaluations += other.evaluations;
+        reEvaluations += other.reEvaluations;
+        upToDate += other.upToDate;
+        incremental += other.incremental;
+        incrementalStates += other.incrementalStates;
+        fused += other.fused;
+        refreshes += other.refreshes;
+        refreshChanges += other.refreshChanges;
+        for (int i = 0; i < RefreshBins; ++i)
+            refreshSizes[i] += other.refreshSizes[i];
+    }
+
+#ifdef SEARCH_STATS
+    void count_evaluation() { ++evaluations; }
+    void count_re_evaluation() { ++reEvaluations; }
+    void count_up_to_date() { ++upToDate; }
+    void count_incremental(int states) {
+        ++incremental;
+        incrementalStates += states;
+    }
+    void count_fused() {
+        ++incremental;
+        ++incrementalStates;
+        ++fused;
+    }
+    void count_refresh(int changes) {
+        ++refreshes;
+        refreshChanges += changes;
+        ++refreshSizes[std::min(int(std::bit_width(unsigned(changes))), RefreshBins - 1)];
+    }
+#else
+    void count_evaluation() {}
+    void count_re_evaluation() {}
+    void count_up_to_date() {}
+    void count_incremental(int) {}
+    void count_fused() {}
+    void count_refresh(int) {}
+#endif
+};
+
+
 // AccumulatorCaches struct provides per-thread accumulator caches, where each
 // cache contains multiple entries for each of the possible king squares.
 // When the accumulator needs to be refreshed, the cached entry is used to more
@@ -76,7 +142,7 @@ struct AccumulatorCaches {
         void clear(const Network& network) {
             for (auto& entries1D : entries) {
                 for (auto& entry : entries1D) {
-                    entry.clear(network.featureTransformer->biases);
+                    entry.clear(network.kernels->biases());
                 }
             }
         }
@@ -90,6 +156,8 @@ struct AccumulatorCaches {
         std::array<Entry, COLOR_NB>& operator[](Square sq) { return entries[sq]; }
 
         std::array<std::array<Entry, COLOR_NB>, SQUARE_NB> entries;
+
+        UpdateStats stats{};
     };
 
     template<typename Networks>
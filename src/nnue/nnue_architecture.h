@@ -32,23 +32,11 @@
 #include "layers/sqr_clipped_relu.h"
 #include "nnue_common.h"
 
-namespace Atom::NNUE {
+namespace Atom::NNUE::NNUE_KERNELS {
 
 // Input features used in evaluation function
 using FeatureSet = Features::HalfKAv2_hm;
 
-// Number of input feature dimensions after conversion
-constexpr IndexType TransformedFeatureDimensionsBig = 3072;
-constexpr int       L2Big                           = 15;
-constexpr int       L3Big                           = 32;
-
-constexpr IndexType TransformedFeatureDimensionsSmall = 128;
-constexpr int       L2Small                           = 15;
-constexpr int       L3Small                           = 32;
-
-constexpr IndexType PSQTBuckets = 8;
-constexpr IndexType LayerStacks = 8;
-
 template<IndexType L1, int L2, int L3>
 struct NetworkArchitecture {
     static constexpr IndexType TransformedFeatureDimensions = L1;
@@ -91,7 +79,7 @@ struct NetworkArchitecture {
             && fc_2.write_parameters(stream);
     }
 
-    std::int32_t propagate(const TransformedFeatureType* transformedFeatures) {
+    std::int32_t propagate(const TransformedFeatureType* transformedFeatures) const {
         struct alignas(CacheLineSize) Buffer {
             alignas(CacheLineSize) typename decltype(fc_0)::OutputBuffer fc_0_out;
             alignas(CacheLineSize) typename decltype(ac_sqr_0)::OutputType
@@ -132,6 +120,9 @@ struct NetworkArchitecture {
     }
 };
 
-}  // namespace Atom::NNUE
+using BigNetworkArchitecture   = NetworkArchitecture<TransformedFeatureDimensionsBig, L2Big, L3Big>;
+using SmallNetworkArchitecture = NetworkArchitecture<TransformedFeatureDimensionsSmall, L2Small, L3Small>;
+
+}  // namespace Atom::NNUE::NNUE_KERNELS
 
 #endif  // #ifndef NNUE_ARCHITECTURE_H_INCLUDED
@@ -84,6 +84,38 @@ constexpr std::size_t MaxSimdWidth = 32;
 using TransformedFeatureType = std::uint8_t;
 using IndexType              = std::uint32_t;
 
+// The NNUE kernels (the layers, the feature transformer and the networks'
+// parameters laid out for them) are compiled once for each instruction set the
+// engine can pick at startup, see network.h. Each copy lives in a namespace
+// named after its instruction set, Atom::NNUE::NNUE_KERNELS.
+#if defined(USE_VNNI)
+    #define NNUE_KERNELS Vnni512
+#elif defined(USE_AVX512)
+    #define NNUE_KERNELS Avx512
+#elif defined(USE_BMI2)
+    #define NNUE_KERNELS Bmi2
+#elif defined(USE_AVX2)
+    #define NNUE_KERNELS Avx2
+#elif defined(USE_SSE41)
+    #define NNUE_KERNELS Sse41
+#elif defined(USE_SSE2)
+    #define NNUE_KERNELS Sse2
+#else
+    #define NNUE_KERNELS Generic
+#endif
+
+// Number of input feature dimensions after conversion
+constexpr IndexType TransformedFeatureDimensionsBig = 3072;
+constexpr int       L2Big                           = 15;
+constexpr int       L3Big                           = 32;
+
+constexpr IndexType TransformedFeatureDimensionsSmall = 128;
+constexpr int       L2Small                           = 15;
+constexpr int       L3Small                           = 32;
+
+constexpr IndexType PSQTBuckets = 8;
+constexpr IndexType LayerStacks = 8;
+
 // Round n up to be a multiple of base
 template<typename IntType>
 constexpr IntType ceil_to_multiple(IntType n, IntType base) {
@@ -34,7 +34,7 @@
 #include "nnue_architecture.h"
 #include "nnue_common.h"
 
-namespace Atom::NNUE {
+namespace Atom::NNUE::NNUE_KERNELS {
 
 using BiasType       = std::int16_t;
 using WeightType     = std::int16_t;
@@ -448,13 +448,6 @@ class FeatureTransformer {
             return true;
         }());
 
-#ifdef VECTOR
-        // Gcc-10.2 unnecessarily spills AVX2 registers if this array
-        // is defined in the VECTOR code below, once in each branch.
-        vec_t      acc[NumRegs];
-        psqt_vec_t psqt[NumPsqtRegs];
-#endif
-
         // Update incrementally going back through states_to_update.
         // Gather all features to be updated.
         const Square ksq = pos.getKingSquare(Perspective);
@@ -474,8 +467,57 @@ class FeatureTransformer {
             for (BoardState* st2 = states_to_update[i]; st2 != end_state; st2 = st2->previous)
                 FeatureSet::append_changed_indices<Perspective>(ksq, st2->dirtyPiece, removed[i],
                                                                 added[i]);
+
+            cancel_common_indices(removed[i], added[i]);
         }
 
+        apply_changes<Perspective, N>(computed_st, states_to_update, removed, added);
+    }
+
+    // Removes the features that are both removed and added, e.g. a piece that
+    // moved twice, or was captured on the square it moved to. Returns whether
+    // any were removed.
+    static bool cancel_common_indices(FeatureSet::IndexList& removed,
+                                      FeatureSet::IndexList& added) {
+        bool cancelled = false;
+
+        for (std::size_t i = 0; i < removed.size();)
+        {
+            std::size_t j = 0;
+            while (j < added.size() && added[j] != removed[i])
+                ++j;
+
+            if (j == added.size())
+            {
+                ++i;
+                continue;
+            }
+
+            removed[i] = removed.back();
+            removed.pop_back();
+            added[j] = added.back();
+            added.pop_back();
+            cancelled = true;
+        }
+
+        return cancelled;
+    }
+
+    // Computes each accumulator in states_to_update[] from the one before it,
+    // starting from computed_st, in a single pass over the accumulator.
+    template<Color Perspective, size_t N>
+    void apply_changes(BoardState*                  computed_st,
+                       BoardState*                  states_to_update[N],
+                       const FeatureSet::IndexList* removed,
+                       const FeatureSet::IndexList* added) const {
+
+#ifdef VECTOR
+        // Gcc-10.2 unnecessarily spills AVX2 registers if this array
+        // is defined in the VECTOR code below, once in each branch.
+        vec_t      acc[NumRegs];
+        psqt_vec_t psqt[NumPsqtRegs];
+#endif
+
         BoardState* st = computed_st;
 
         // Now update the accumulators listed in states_to_update[],
@@ -684,6 +726,8 @@ class FeatureTransformer {
             }
         }
 
+        cache->stats.count_refresh(int(removed.size() + added.size()));
+
         auto& accumulator                 = pos.getState()->*accPtr;
         accumulator.computed[Perspective] = true;
 
@@ -831,11 +875,35 @@ class FeatureTransformer {
             // Only update current position accumulator to minimize work
             BoardState* states_to_update[1] = {pos.getState()};
             update_accumulator_incremental<Perspective, 1>(pos, oldest_st, states_to_update);
+            cache->stats.count_incremental(1);
         }
         else
             update_accumulator_refresh_cache<Perspective>(pos, cache);
     }
 
+    // When the accumulators between computed_st and pos were never computed,
+    // and some of the features changed on the way cancel out, computes only the
+    // accumulator of pos, from the net change of all the plies in one pass.
+    // Returns false, doing nothing, if no features cancel out.
+    template<Color Perspective>
+    bool update_accumulator_fused(const Position& pos, BoardState* computed_st) const {
+        const Square          ksq = pos.getKingSquare(Perspective);
+        FeatureSet::IndexList removed[1], added[1];
+
+        for (BoardState* st = pos.getState(); st != computed_st; st = st->previous)
+            FeatureSet::append_changed_indices<Perspective>(ksq, st->dirtyPiece, removed[0],
+                                                            added[0]);
+
+        if (!cancel_common_indices(removed[0], added[0]))
+            return false;
+
+        BoardState* states_to_update[1] = {pos.getState()};
+        (pos.getState()->*accPtr).computed[Perspective] = true;
+
+        apply_changes<Perspective, 1>(computed_st, states_to_update, removed, added);
+        return true;
+    }
+
     template<Color Perspective>
     void update_accumulator(const Position&                           pos,
                             AccumulatorCaches::Cache<HalfDimensions>* cache) const {
@@ -845,7 +913,10 @@ class FeatureTransformer {
         if ((oldest_st->*accPtr).computed[Perspective])
         {
             if (next == nullptr)
+            {
+                cache->stats.count_up_to_date();
                 return;
+            }
 
             // Now update the accumulators listed in states_to_update[], where
             // the last element is a sentinel. Currently we update two accumulators:
@@ -857,26 +928,37 @@ class FeatureTransformer {
                 BoardState* states_to_update[1] = {next};
 
                 update_accumulator_incremental<Perspective, 1>(pos, oldest_st, states_to_update);
+                cache->stats.count_incremental(1);
             }
+            else if (update_accumulator_fused<Perspective>(pos, oldest_st))
+                cache->stats.count_fused();
             else
             {
                 BoardState* states_to_update[2] = {next, pos.getState()};
 
                 update_accumulator_incremental<Perspective, 2>(pos, oldest_st, states_to_update);
+                cache->stats.count_incremental(2);
             }
         }
         else
             update_accumulator_refresh_cache<Perspective>(pos, cache);
     }
 
-    template<IndexType Size>
-    friend struct AccumulatorCaches::Cache;
+   public:
+    // Accumulator cache entries start from the biases
+    const BiasType* get_biases() const { return biases; }
 
+   private:
     alignas(CacheLineSize) BiasType biases[HalfDimensions];
     alignas(CacheLineSize) WeightType weights[HalfDimensions * InputDimensions];
     alignas(CacheLineSize) PSQTWeightType psqtWeights[InputDimensions * PSQTBuckets];
 };
 
-}  // namespace Atom::NNUE
+using BigFeatureTransformer =
+  FeatureTransformer<TransformedFeatureDimensionsBig, &BoardState::accumulatorBig>;
+using SmallFeatureTransformer =
+  FeatureTransformer<TransformedFeatureDimensionsSmall, &BoardState::accumulatorSmall>;
+
+}  // namespace Atom::NNUE::NNUE_KERNELS
 
 #endif  // #ifndef NNUE_FEATURE_TRANSFORMER_H_INCLUDED
@@ -200,4 +200,54 @@ trace(Position& pos, const NNUE::Networks& networks, NNUE::AccumulatorCaches& ca
 }
 
 
+
+// Returns a table of the accumulator update counters of both networks
+std::string update_stats_table(const UpdateStats& big, const UpdateStats& small) {
+    std::stringstream ss;
+
+    const auto row = [&](const char* name, std::uint64_t b, std::uint64_t s) {
+        ss << std::left << std::setw(26) << name << std::right << std::setw(14) << b
+           << std::setw(14) << s << '\n';
+    };
+    const auto ratio = [&](const char* name, double b, double s) {
+        ss << std::left << std::setw(26) << name << std::right << std::fixed << std::setprecision(2)
+           << std::setw(14) << b << std::setw(14) << s << '\n';
+    };
+    const auto per = [](std::uint64_t num, std::uint64_t denom) {
+        return denom ? double(num) / double(denom) : 0.0;
+    };
+
+    const std::uint64_t bigUpdates   = big.upToDate + big.incremental + big.refreshes;
+    const std::uint64_t smallUpdates = small.upToDate + small.incremental + small.refreshes;
+
+    ss << std::left << std::setw(26) << "" << std::right << std::setw(14) << "big"
+       << std::setw(14) << "small" << '\n';
+    row("evaluations", big.evaluations, small.evaluations);
+    row("re-evaluated by big net", 0, small.reEvaluations);
+    row("perspectives up to date", big.upToDate, small.upToDate);
+    row("incremental updates", big.incremental, small.incremental);
+    row("  fused over plies", big.fused, small.fused);
+    row("cache refreshes", big.refreshes, small.refreshes);
+    ratio("accumulators/incremental", per(big.incrementalStates, big.incremental),
+          per(small.incrementalStates, small.incremental));
+    ratio("features/refresh", per(big.refreshChanges, big.refreshes),
+          per(small.refreshChanges, small.refreshes));
+    ratio("refresh share (%)", 100 * per(big.refreshes, bigUpdates),
+          100 * per(small.refreshes, smallUpdates));
+
+    ss << "\nfeatures changed per refresh\n";
+    for (int i = 0; i < UpdateStats::RefreshBins; ++i)
+    {
+        std::string name = i == 0 ? "0"
+                         : i == 1 ? "1"
+                                  : std::to_string(1 << (i - 1)) + "-" + std::to_string((1 << i) - 1);
+        if (i == UpdateStats::RefreshBins - 1)
+            name = std::to_string(1 << (i - 1)) + "+";
+
+        row(("  " + name).c_str(), big.refreshSizes[i], small.refreshSizes[i]);
+    }
+
+    return ss.str();
+}
+
 }  // namespace Atom::NNUE
@@ -23,7 +23,7 @@
 #include <string>
 
 #include "../types.h"
-#include "nnue_architecture.h"
+#include "nnue_common.h"
 
 namespace Atom {
 
@@ -52,12 +52,15 @@ struct NnueEvalTrace {
 
 struct Networks;
 struct AccumulatorCaches;
+struct UpdateStats;
 
 std::string trace(Position& pos, const Networks& networks, AccumulatorCaches& caches);
 void        hint_common_parent_position(const Position&    pos,
                                         const Networks&    networks,
                                         AccumulatorCaches& caches);
 
+std::string update_stats_table(const UpdateStats& big, const UpdateStats& small);
+
 }  // namespace Atom::NNUE
 }  // namespace Atom
 
@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <tuple>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "numa.h"
+
+namespace Atom {
+
+namespace Numa {
+
+namespace {
+
+// Parses a list of CPUs in the kernel's format, e.g. "0-3,8,10-11"
+std::optional<std::vector<int>> parseCpuList(const std::string& str) {
+    std::vector<int> cpus;
+    const char* p   = str.data();
+    const char* end = p + str.size();
+
+    while (p < end && *p != '\n') {
+        int first, last;
+
+        auto [q, ec] = std::from_chars(p, end, first);
+        if (ec != std::errc() || first < 0) return std::nullopt;
+        last = first;
+
+        if (q < end && *q == '-') {
+            auto [r, ec2] = std::from_chars(q + 1, end, last);
+            if (ec2 != std::errc() || last < first) return std::nullopt;
+            q = r;
+        }
+
+        for (int cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(cpu);
+
+        p = q;
+        if (p < end && *p == ',') ++p;
+        else if (p < end && *p != '\n') return std::nullopt;
+    }
+
+    return cpus;
+}
+
+
+std::optional<std::string> readLine(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+
+    if (!file || !std::getline(file, line)) return std::nullopt;
+    return line;
+}
+
+
+int readInt(const std::string& path, int fallback) {
+    const std::optional<std::string> line = readLine(path);
+    int value;
+
+    if (!line || std::from_chars(line->data(), line->data() + line->size(), value).ec != std::errc())
+        return fallback;
+
+    return value;
+}
+
+
+std::vector<CpuInfo> readTopology() {
+    std::vector<CpuInfo> cpus;
+
+#if defined(__linux__)
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (!CPU_ISSET(cpu, &mask)) continue;
+
+            const std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+            cpus.push_back({cpu, 0, readInt(dir + "physical_package_id", 0), readInt(dir + "core_id", cpu), 0});
+        }
+    }
+
+    // Each node lists its CPUs in its own directory
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it("/sys/devices/system/node", ec), end; !ec && it != end; it.increment(ec)) {
+        const std::string name = it->path().filename().string();
+        int node;
+
+        if (   name.rfind("node", 0) != 0
+            || std::from_chars(name.data() + 4, name.data() + name.size(), node).ec != std::errc())
+            continue;
+
+        const std::optional<std::string> line = readLine(it->path().string() + "/cpulist");
+        const std::optional<std::vector<int>> nodeCpus = line ? parseCpuList(*line) : std::nullopt;
+        if (!nodeCpus) continue;
+
+        for (CpuInfo& info : cpus) {
+            if (std::find(nodeCpus->begin(), nodeCpus->end(), info.cpu) != nodeCpus->end())
+                info.node = node;
+        }
+    }
+#endif
+
+    if (cpus.empty()) {
+        for (int cpu = 0; cpu < int(std::max(1u, std::thread::hardware_concurrency())); ++cpu)
+            cpus.push_back({cpu, 0, 0, cpu, 0});
+    }
+
+    // Number the SMT siblings of each core
+    std::sort(cpus.begin(), cpus.end(), [](const CpuInfo& a, const CpuInfo& b) {
+        return std::tie(a.package, a.core, a.cpu) < std::tie(b.package, b.core, b.cpu);
+    });
+
+    for (size_t i = 1; i < cpus.size(); ++i) {
+        if (cpus[i].package == cpus[i - 1].package && cpus[i].core == cpus[i - 1].core)
+            cpus[i].sibling = cpus[i - 1].sibling + 1;
+    }
+
+    std::sort(cpus.begin(), cpus.end(), [](const CpuInfo& a, const CpuInfo& b) { return a.cpu < b.cpu; });
+
+    return cpus;
+}
+
+} // namespace
+
+
+const std::vector<CpuInfo>& topology() {
+    static const std::vector<CpuInfo> cpus = readTopology();
+    return cpus;
+}
+
+
+int nbNodes() {
+    int maxNode = 0;
+    for (const CpuInfo& info : topology())
+        maxNode = std::max(maxNode, info.node);
+    return maxNode + 1;
+}
+
+
+int nodeOf(int cpu) {
+    for (const CpuInfo& info : topology()) {
+        if (info.cpu == cpu) return info.node;
+    }
+    return 0;
+}
+
+
+std::optional<Binding> parseBinding(const std::string& str) {
+    if (str == "none")    return Binding{BindPolicy::NONE, {}};
+    if (str == "compact") return Binding{BindPolicy::COMPACT, {}};
+    if (str == "spread")  return Binding{BindPolicy::SPREAD, {}};
+
+    std::optional<std::vector<int>> cpus = parseCpuList(str);
+    if (!cpus || cpus->empty()) return std::nullopt;
+
+    return Binding{BindPolicy::CPULIST, *cpus};
+}
+
+
+std::string toString(const Binding& binding) {
+    switch (binding.policy) {
+    case BindPolicy::NONE:    return "none";
+    case BindPolicy::COMPACT: return "compact";
+    case BindPolicy::SPREAD:  return "spread";
+    case BindPolicy::CPULIST: break;
+    }
+
+    std::string str;
+    for (size_t i = 0; i < binding.cpus.size(); ++i)
+        str += (i ? "," : "") + std::to_string(binding.cpus[i]);
+    return str;
+}
+
+
+std::vector<int> plan(const Binding& binding, size_t nbThreads) {
+    std::vector<int> order;
+
+    if (binding.policy == BindPolicy::CPULIST) {
+        order = binding.cpus;
+
+    } else if (binding.policy != BindPolicy::NONE) {
+        // Each node's CPUs, physical cores first
+        std::vector<CpuInfo> cpus = topology();
+        std::sort(cpus.begin(), cpus.end(), [](const CpuInfo& a, const CpuInfo& b) {
+            return std::tie(a.node, a.sibling, a.cpu) < std::tie(b.node, b.sibling, b.cpu);
+        });
+
+        if (binding.policy == BindPolicy::COMPACT) {
+            for (const CpuInfo& info : cpus)
+                order.push_back(info.cpu);
+        } else {
+            std::vector<std::vector<int>> byNode(nbNodes());
+            for (const CpuInfo& info : cpus)
+                byNode[info.node].push_back(info.cpu);
+
+            for (size_t round = 0; order.size() < cpus.size(); ++round) {
+                for (const std::vector<int>& nodeCpus : byNode) {
+                    if (round < nodeCpus.size()) order.push_back(nodeCpus[round]);
+                }
+            }
+        }
+    }
+
+    std::vector<int> cpuOf(nbThreads, -1);
+    if (!order.empty()) {
+        for (size_t i = 0; i < nbThreads; ++i)
+            cpuOf[i] = order[i % order.size()];
+    }
+
+    return cpuOf;
+}
+
+
+bool bindThisThread(int cpu) {
+#if defined(__linux__)
+    if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(cpu, &mask);
+
+    return sched_setaffinity(0, sizeof(mask), &mask) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+} // namespace Numa
+
+} // namespace Atom
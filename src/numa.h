@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Atom {
+
+namespace Numa {
+
+// A logical CPU this process may run on, and where it sits in the machine
+struct CpuInfo {
+    int cpu;
+    int node;       // NUMA node
+    int package;    // Socket
+    int core;       // Physical core within the package, shared by SMT siblings
+    int sibling;    // Which of the core's SMT siblings this is, 0 for the first
+};
+
+// The CPUs this process was allowed to run on at startup, read from sysfs.
+// Without topology information, every CPU is taken to be its own core on node 0.
+const std::vector<CpuInfo>& topology();
+
+int nbNodes();
+
+// The node a CPU belongs to, 0 if it is unknown
+int nodeOf(int cpu);
+
+
+// How the search threads are placed on CPUs
+enum class BindPolicy {
+    NONE,       // Left to the OS
+    COMPACT,    // Filling one node before moving on to the next
+    SPREAD,     // Round robin over the nodes
+    CPULIST,    // On the CPUs given, in order
+};
+
+struct Binding {
+    BindPolicy       policy = BindPolicy::NONE;
+    std::vector<int> cpus;  // Only for CPULIST
+};
+
+// Parses "none", "compact", "spread" or a CPU list such as "0-7,16-23"
+std::optional<Binding> parseBinding(const std::string& str);
+
+std::string toString(const Binding& binding);
+
+// The CPU each of nbThreads threads should be bound to, or -1 to leave it unbound.
+// Physical cores are used before their SMT siblings, and when there are more
+// threads than CPUs, the CPUs are used again from the start.
+std::vector<int> plan(const Binding& binding, size_t nbThreads);
+
+// Binds the calling thread to a single CPU. Returns false if it could not be.
+bool bindThisThread(int cpu);
+
+} // namespace Numa
+
+} // namespace Atom
@@ -7,6 +7,8 @@
 #include "zobrist.h"
 #include "uci.h"
 
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
@@ -255,21 +257,38 @@ Position::Position() {
 // Creates a copy of another position.
 Position::Position(const Position &other) {
     history = new BoardState[MAX_HISTORY];
-    std::memcpy(this, &other, sizeof(Position));
-    this->state = this->history + (other.state - other.history);
+    copyFrom(other);
 }
 
 
 // Copy assignment operator
 Position& Position::operator=(const Position &other) {
     if (this == &other) return *this; // Self assignment check
-    std::memcpy(this, &other, sizeof(Position));
-    this->state = this->history + (other.state - other.history);
+    copyFrom(other);
 
     return *this;
 }
 
 
+// Copies another position into this one, keeping our own history array.
+// Only the states since the last irreversible move are copied: nothing
+// before that can be reached by repetition detection, and NNUE will
+// refresh from scratch if it runs out of previous states.
+void Position::copyFrom(const Position &other) {
+    BoardState *ownHistory = history;
+    std::memcpy(static_cast<void*>(this), &other, sizeof(Position));
+    history = ownHistory;
+    state   = history + (other.state - other.history);
+
+    const BoardState *first = std::max(other.state - other.state->fiftyMoveRule, other.history);
+    BoardState *st = history + (first - other.history);
+    std::memcpy(static_cast<void*>(st), first, (state - st + 1) * sizeof(BoardState));
+
+    st->previous = nullptr;
+    while (st++ != state) st->previous = st - 1;
+}
+
+
 // Destructor
 Position::~Position() {
     delete[] history;
@@ -282,9 +301,14 @@ void Position::reset() {
 
     state->fiftyMoveRule = 0;
     state->halfMoves = 0;
+    state->pliesFromNull = 0;
     state->epSquare = SQ_NONE;
     state->castlingRights = NO_CASTLING;
     state->move = MOVE_NONE;
+    state->previous = nullptr;
+
+    state->accumulatorBig.computed[WHITE] = state->accumulatorBig.computed[BLACK] =
+        state->accumulatorSmall.computed[WHITE] = state->accumulatorSmall.computed[BLACK] = false;
 
     for(int i = 0; i < SQUARE_NB; i++) pieces[i]   = NO_PIECE;
     for(int i = 0; i < PIECE_NB;  i++) piecesBB[i] = EMPTY;
@@ -505,6 +529,7 @@ void Position::doMove(Move m) {
     state->castlingRights = oldState->castlingRights;
     state->fiftyMoveRule = oldState->fiftyMoveRule + 1;
     state->halfMoves = oldState->halfMoves + 1;
+    state->pliesFromNull = oldState->pliesFromNull + 1;
     state->captured = captured;
     state->move = m;
     state->previous = oldState;
@@ -754,7 +779,12 @@ void Position::doNullMove(TranspositionTable& tt) {
 
     assert(!checkers());
 
-    ++state;
+    // Copy current state to next state, up to the NNUE data
+    BoardState *oldState = state++;
+    std::memcpy(state, oldState, offsetof(BoardState, dirtyPiece));
+    state->previous = oldState;
+    state->move     = MOVE_NULL;
+    state->captured = NO_PIECE;
 
     // Handle NNUE
     state->dirtyPiece.dirty_num = 0;
@@ -762,15 +792,14 @@ void Position::doNullMove(TranspositionTable& tt) {
     state->accumulatorBig.computed[WHITE] = state->accumulatorBig.computed[BLACK] =
         state->accumulatorSmall.computed[WHITE] = state->accumulatorSmall.computed[BLACK] = false;
 
-    // Increment fifty move rule
+    // Increment fifty move rule. Repetitions cannot span a null move.
     ++state->fiftyMoveRule;
+    state->pliesFromNull = 0;
 
-    // Reset EP square
-    state->epSquare = SQ_NONE;
-
-    // Handle hash
+    // Handle hash, removing the en passant square before it is reset
     state->hash ^= Zobrist::enpassantKeys[fileOf(state->epSquare) + FILE_NB * (state->epSquare == SQ_NONE)];
     state->hash ^= Zobrist::sideToMoveKey;
+    state->epSquare = SQ_NONE;
 
     // Prefetch entry here to save time
     tt.prefetch(hash());
@@ -2,7 +2,7 @@
 
 #include "bitboard.h"
 #include "nnue/nnue_accumulator.h"
-#include "nnue/nnue_architecture.h"
+#include "nnue/nnue_common.h"
 #include "tt.h"
 #include "types.h"
 #include "zobrist.h"
@@ -26,6 +26,7 @@ struct BoardState {
     Square        epSquare;
     int           fiftyMoveRule;
     int           halfMoves;
+    int           pliesFromNull;
 
     // Previous move and captured piece, used to unmake moves
     Move  move;
@@ -154,6 +155,9 @@ public:
     inline bool isFiftyMoveDraw()   const { return state->fiftyMoveRule > 99; }
     inline bool isDraw()            const { return isMaterialDraw() || isFiftyMoveDraw() || isRepetitionDraw(); }
 
+    // Check if the side to move can reach an earlier position with a reversible move.
+    inline bool hasGameCycle(int ply) const;
+
     // Get the previous move.
     inline Move previousMove() const { return state->move; }
 
@@ -231,6 +235,8 @@ private:
     inline void updateBitboards();
     template <Color Me> inline void updateBitboards();
 
+    void copyFrom(const Position &other);
+
     template<Color Me, bool IsInCheck, bool IsCapture>
     inline bool isInMoveList(const Move m, const Piece pc) const;
 
@@ -293,6 +299,65 @@ inline bool Position::isRepetitionDraw() const {
 }
 
 
+// Check to see if the side to move has a move that draws by repetition, or
+// if an earlier position in the search tree has already repeated.
+//
+// This uses the cuckoo tables from Zobrist: the hash difference between the
+// current position and an earlier one (with the same side to move) is looked
+// up in the tables. If it matches a reversible move whose path is clear,
+// that move returns us to the earlier position.
+// See "Detecting upcoming repetitions" by Marcel van Kervinck.
+inline bool Position::hasGameCycle(int ply) const {
+    const int end = std::min(getHalfMoveClock(), state->pliesFromNull);
+
+    if (end < 3)
+        return false;
+
+    const Key originalKey = hash();
+    const BoardState *st  = state - 1;
+    Key other = originalKey ^ st->hash ^ Zobrist::sideToMoveKey;
+
+    for (int i = 3; i <= end; i += 2) {
+        other ^= (st - 1)->hash ^ (st - 2)->hash ^ Zobrist::sideToMoveKey;
+        st -= 2;
+
+        // The pieces moved in between must cancel out
+        if (other != 0)
+            continue;
+
+        const Key moveKey = originalKey ^ st->hash;
+        int j = Zobrist::cuckooH1(moveKey);
+
+        if (Zobrist::cuckoo[j] != moveKey) {
+            j = Zobrist::cuckooH2(moveKey);
+
+            if (Zobrist::cuckoo[j] != moveKey)
+                continue;
+        }
+
+        const Move move = Zobrist::cuckooMove[j];
+
+        // The path of the move must be clear
+        if (BETWEEN_BB[moveFrom(move)][moveTo(move)] & getPiecesBB())
+            continue;
+
+        // Inside the search tree, reaching the earlier position is enough
+        if (ply > i)
+            return true;
+
+        // At or before the root, the earlier position must have already
+        // repeated itself, otherwise this is not a draw yet.
+        const int limit = std::min(st->fiftyMoveRule, st->pliesFromNull);
+        for (int k = 4; k <= limit; k += 2) {
+            if ((st - k)->hash == st->hash)
+                return true;
+        }
+    }
+
+    return false;
+}
+
+
 // Does the given move for the current position
 template <Color Me>
 inline void Position::doMove(Move m) {
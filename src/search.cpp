@@ -3,6 +3,7 @@
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <iterator>
 
 #include "search.h"
 #include "evaluate.h"
@@ -11,6 +12,7 @@
 #include "nnue/nnue_misc.h"
 #include "position.h"
 #include "thread.h"
+#include "trace.h"
 #include "tt.h"
 #include "tunables.h"
 #include "types.h"
@@ -20,6 +22,17 @@ namespace Atom {
 
 namespace Search {
 
+// Helper threads skip some iterations, so that they are spread over more
+// depths rather than all searching the same one. Helper i skips blocks of
+// SKIP_SIZE[i] depths in turn, offset by SKIP_PHASE[i]. The schedule repeats
+// every 20 helpers.
+constexpr int SKIP_SIZE[]  = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+constexpr int SKIP_PHASE[] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+// Below this depth, moves are not shared between threads through the searching
+// table: the subtrees are too small to be worth it.
+constexpr Depth SHARE_MIN_DEPTH = 4;
+
 
 void SearchWorker::clear() {
     for (size_t i = 1; i < reductions.size(); ++i) {
@@ -40,6 +53,7 @@ void SearchWorker::clear() {
     correctionHist.fill(0);
 
     cacheTable.clear(networks);
+    evalHash.clear();
 }
 
 
@@ -56,30 +70,24 @@ void SearchWorker::onNewPv(
     const RootMove& bestMove = bestWorker.rootMoves[0];
     const Position& rootPos  = bestWorker.rootPosition;
 
-    std::string pv;
-    for (const Move m : bestMove.pv) {
-        pv += Uci::formatMove(m) + " ";
-    }
-
-    // Remove last whitespace
-    if (!pv.empty()) pv.pop_back();
-
     SearchInfo info;
 
     info.depth         = depth;
     info.selDepth      = bestMove.selDepth;
-    info.score         = Uci::formatScore(bestMove.uciScore, rootPos);
+    info.score         = bestMove.uciScore;
+    info.rootPos       = &rootPos;
     info.nodesSearched = totalNodesSearched;
     info.hashFull      = tt.hashfull();
     info.tbHits        = totalTbHits;
     info.timeSearched  = now() - limits.startTimePoint;
-    info.pv            = pv;
+    info.pv            = std::span<const Move>(bestMove.pv.begin(), bestMove.pv.size());
 
     Uci::callbackInfo(info);
 }
 
 
 void SearchWorker::startSearch() {
+    startedAt.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_release);
 
     // All threads except the first one go straight to searching
     if (!isFirstThread()) {
@@ -102,8 +110,8 @@ void SearchWorker::startSearch() {
         rootMoves.push_back(Move::MOVE_NONE);
     }
 
-    // If the search is infinite, wait here and do nothing.
-    while (limits.isInfinite && !threads.shouldStop) 
+    // If the search is infinite or we are pondering, wait here and do nothing.
+    while ((limits.isInfinite || threads.ponder) && !threads.shouldStop) 
         {}
 
     // Wait for the other threads to stop
@@ -116,18 +124,22 @@ void SearchWorker::startSearch() {
         threads.firstWorker()->onNewPv(*bestWorker, threads, tt, bestWorker->completedDepth);
     }
 
-    std::string bestmove = Uci::formatMove(bestWorker->rootMoves[0].pv[0]);
-    std::string ponder;
-    if (bestWorker->rootMoves[0].pv.size() > 1) {
-        ponder = Uci::formatMove(bestWorker->rootMoves[0].pv[1]);
+    if (threads.size() > 1) {
+#ifdef SEARCH_STATS
+        const SearchStats total = threads.totalStats();
+        Uci::callbackTTWrites(total.total(STAT_TT_WRITE), total.total(STAT_TT_NEW_WRITE));
+#endif
+        Uci::callbackDeferred(threads.totalDeferCandidates(), threads.totalDeferredMoves());
     }
 
-    Uci::callbackBestMove(bestmove, ponder);
+    const MoveList& pv = bestWorker->rootMoves[0].pv;
+    Uci::callbackBestMove(pv[0], pv.size() > 1 ? pv[1] : MOVE_NONE);
 }
 
 
 template <Color Me>
 void SearchWorker::iterativeDeepening() {
+    TRACE_SCOPE("SearchWorker::iterativeDeepening");
 
     Value bestScore = -VALUE_INFINITE;
     Value alpha, beta;
@@ -154,6 +166,12 @@ void SearchWorker::iterativeDeepening() {
     // Main iterative deepening loop
     while (++rootDepth < MAX_PLY && !threads.shouldStop
         && !(limits.depth && rootDepth > limits.depth && isFirstThread())) {
+        TRACE_SCOPE("iteration");
+
+        if (!isFirstThread()) {
+            const size_t i = (idx - 1) % std::size(SKIP_SIZE);
+            if (((rootDepth + SKIP_PHASE[i]) / SKIP_SIZE[i]) % 2) continue;
+        }
 
         // Save the last iteration's scores for better
         // move ordering
@@ -231,6 +249,13 @@ void SearchWorker::iterativeDeepening() {
 }
 
 
+// Stops the search once the movetime limit has passed, unless pondering
+void SearchWorker::checkTime() {
+    if (limits.moveTime && !threads.ponder && now() - limits.startTimePoint >= limits.moveTime)
+        threads.shouldStop = true;
+}
+
+
 // TODO: Add CutNode to template?
 template <Color Me, NodeType NT>
 Value SearchWorker::pvSearch(
@@ -245,7 +270,18 @@ Value SearchWorker::pvSearch(
         return qSearch<Me, QNodeType>(pos, sPtr, alpha, beta, 0);
     }
 
-    // TODO: Time management should quickly check time here
+    // If we have a move that draws by repetition, we can score this node as at
+    // least a draw. This lets us skip the search entirely if that is enough.
+    if (!RootNode && alpha < VALUE_DRAW && pos.hasGameCycle(sPtr->ply)) {
+        alpha = VALUE_DRAW - 1 + (nodes & 0x2);
+        if (alpha >= beta) return alpha;
+    }
+
+    // The first thread checks the time every so often
+    if (isFirstThread() && --timeCheckCountdown <= 0) {
+        timeCheckCountdown = TIME_CHECK_INTERVAL;
+        checkTime();
+    }
 
     // Ensure depth does not exceed max ply
     depth = std::min(depth, MAX_PLY - 1);
@@ -261,6 +297,8 @@ Value SearchWorker::pvSearch(
 
     SearchWorker* thisThread = this;
 
+    SEARCH_STAT(STAT_NODES, depth);
+
     Move pv[MAX_PLY + 1];
     Move currentMove, bestMove = MOVE_NONE;
     Value bestScore = -VALUE_INFINITE;
@@ -284,7 +322,7 @@ Value SearchWorker::pvSearch(
         // See if search has been aborted
         if (threads.shouldStop.load(std::memory_order_relaxed) || pos.isDraw()) {
             return (sPtr->inCheck && sPtr->ply >= MAX_PLY)
-                ? Eval::evaluate<Me>(pos, networks, cacheTable, thisThread->optimism[Me])
+                ? Eval::evaluate<Me>(pos, networks, cacheTable, evalHash, thisThread->optimism[Me])
                 : VALUE_DRAW - 1 + (nodes & 0x2);
         }
 
@@ -299,6 +337,11 @@ Value SearchWorker::pvSearch(
     sPtr->statScore      = 0;
     (sPtr + 1)->killer   = MOVE_NONE;
 
+    // While checking whether excludedMove is singular, this node is searched
+    // without it. Its results then only hold for the other moves, so they are
+    // never cut off by, nor written to, the TT.
+    const Move excludedMove = sPtr->excludedMove;
+
     // Transposition table probe
     auto [ttHit, ttData, ttWriter] = tt.probe(pos.hash());
     sPtr->ttHit = ttHit;
@@ -310,9 +353,10 @@ Value SearchWorker::pvSearch(
     ttData.score = ttHit ? ttData.getAdjustedScore(sPtr->ply) : VALUE_NONE;
 
     // Transposition table cutoff
-    if (!PvNode && ttHit && ttData.depth > depth - (ttData.score <= beta) &&
+    if (!PvNode && !excludedMove && ttHit && ttData.depth > depth - (ttData.score <= beta) &&
         ttData.score != VALUE_NONE &&
         ttData.bound & (ttData.score >= beta ? BOUND_LOWER : BOUND_UPPER)) {
+      SEARCH_STAT(STAT_TT_CUTOFF, depth);
       return ttData.score;
     }
 
@@ -321,8 +365,12 @@ Value SearchWorker::pvSearch(
 
 
     if (!sPtr->inCheck) {
-        if (ttHit) {
-            rawEval = (ttData.eval != VALUE_NONE ? ttData.eval : Eval::evaluate<Me>(pos, networks, cacheTable, thisThread->optimism[Me]));
+        if (excludedMove) {
+            // The same position was just evaluated by the search this came from
+            eval = sPtr->staticEval;
+
+        } else if (ttHit) {
+            rawEval = (ttData.eval != VALUE_NONE ? ttData.eval : Eval::evaluate<Me>(pos, networks, cacheTable, evalHash, thisThread->optimism[Me]));
 
             if (PvNode && ttData.eval != VALUE_NONE) {
                 NNUE::hint_common_parent_position(pos, networks, cacheTable);
@@ -335,10 +383,11 @@ Value SearchWorker::pvSearch(
             }
 
         } else {
-            rawEval = Eval::evaluate<Me>(pos, networks, cacheTable, thisThread->optimism[Me]);
+            rawEval = Eval::evaluate<Me>(pos, networks, cacheTable, evalHash, thisThread->optimism[Me]);
 
             sPtr->staticEval = eval = correctStaticEval<Me>(rawEval, pos);
 
+            countTTWrite(ttWriter, pos.hash(), depth);
             ttWriter.write(pos.hash(), VALUE_NONE, rawEval, -2, sPtr->ttPv,
                          MOVE_NONE, tt.getAge(), BOUND_NONE);
 
@@ -352,6 +401,7 @@ Value SearchWorker::pvSearch(
         if (!PvNode && !sPtr->inCheck && depth <= Tunables::RFP_DEPTH &&
             eval - (Tunables::RFP_DEPTH_MULTIPLIER * depth) >= beta
         ) {
+            SEARCH_STAT(STAT_RFP_PRUNE, depth);
             return eval;
         }
 
@@ -361,6 +411,7 @@ Value SearchWorker::pvSearch(
         ) {
             Value score = qSearch<Me, NODETYPE_NON_PV>(pos, sPtr, alpha - 1, alpha, 0);
             if (score < alpha && std::abs(score) < VALUE_TB_WIN_IN_MAX_PLY) {
+                SEARCH_STAT(STAT_RAZOR_PRUNE, depth);
                 return score;
             }
         }
@@ -372,6 +423,7 @@ Value SearchWorker::pvSearch(
             && beta > VALUE_TB_LOSS_IN_MAX_PLY
             && eval < VALUE_TB_WIN_IN_MAX_PLY
         ) {
+            SEARCH_STAT(STAT_FUTILITY_PRUNE, depth);
             return beta + (eval - beta) / 3;
         }
 
@@ -379,6 +431,7 @@ Value SearchWorker::pvSearch(
         if (   cutNode
             && eval >= beta
             && (sPtr - 1)->currentMove != MOVE_NULL
+            && !excludedMove
             && (sPtr - 1)->statScore < Tunables::NMP_VERIFICATION_MAX_STATSCORE
             && sPtr->staticEval >= Tunables::NMP_VERIFICATION_MIN_STAT_EVAL_BASE + beta - (Tunables::NMP_VERIFICATION_MIN_STAT_EVAL_DEPTH_SCALE * depth)
             && sPtr->ply >= nmpCutoff
@@ -388,6 +441,8 @@ Value SearchWorker::pvSearch(
 
             assert(eval - beta >= 0);
 
+            SEARCH_STAT(STAT_NMP_TRIED, depth);
+
             Depth R = getNullMoveReductionAmount(eval, beta, depth);
             sPtr->currentMove = MOVE_NULL;
             sPtr->continuationHist = &thisThread->continuationHist[0][0][NO_PIECE][0];
@@ -400,6 +455,7 @@ Value SearchWorker::pvSearch(
 
                 // Ensure we don't run verification search too often
                 if (thisThread->nmpCutoff || depth < Tunables::NMP_VERIFICATION_MIN_DEPTH) {
+                    SEARCH_STAT(STAT_NMP_CUTOFF, depth);
                     return nullSearchScore;
                 }
 
@@ -413,11 +469,77 @@ Value SearchWorker::pvSearch(
                 thisThread->nmpCutoff = 0;
 
                 if (v >= beta) {
+                    SEARCH_STAT(STAT_NMP_CUTOFF, depth);
                     return nullSearchScore;
                 }
             }
         }
 
+        // ProbCut.
+        // If a good capture beats beta by a margin in a shallower search, the
+        // full search would very likely fail high too, so the node is cut off.
+        const Value probCutBeta = beta + Tunables::PROBCUT_MARGIN - Tunables::PROBCUT_IMPROVING_MARGIN * improving;
+
+        if (   !PvNode
+            && !excludedMove
+            && depth >= Tunables::PROBCUT_MIN_DEPTH
+            && std::abs(beta) < VALUE_TB_WIN_IN_MAX_PLY
+            && !(ttData.depth >= depth - Tunables::PROBCUT_DEPTH_REDUCTION + 1
+                 && ttData.score != VALUE_NONE
+                 && ttData.score < probCutBeta)
+        ) {
+            const Depth probCutDepth = depth - Tunables::PROBCUT_DEPTH_REDUCTION;
+
+            // Only captures that can make up the distance to probCutBeta by themselves
+            Movepicker::MovePicker<Me> pcMp(pos, ttData.move, probCutBeta - sPtr->staticEval, &thisThread->captureHist);
+
+            while ((currentMove = pcMp.nextMove()) != MOVE_NONE) {
+                assert(pos.isPseudoLegalMove<Me>(currentMove));
+
+                SEARCH_STAT(STAT_PROBCUT_TRIED, depth);
+
+                tt.prefetch(pos.hashAfter(currentMove));
+
+                sPtr->currentMove = currentMove;
+                sPtr->continuationHist = &thisThread->continuationHist[0][pos.isCapture(currentMove)][pos.getPieceAt(moveFrom(currentMove))][moveTo(currentMove)];
+
+                thisThread->nodes.store(thisThread->nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+                pos.doMove<Me>(currentMove);
+
+                // Check the capture holds in qsearch before searching it properly
+                Value score = -qSearch<~Me, NODETYPE_NON_PV>(pos, sPtr + 1, -probCutBeta, -probCutBeta + 1, 0);
+
+                if (score >= probCutBeta) {
+                    score = -pvSearch<~Me, NODETYPE_NON_PV>(pos, sPtr + 1, -probCutBeta, -probCutBeta + 1, probCutDepth - 1, !cutNode);
+                }
+
+                pos.undoMove<Me>(currentMove);
+
+                if (threads.shouldStop.load(std::memory_order_relaxed)) {
+                    return VALUE_ZERO;
+                }
+
+                if (score >= probCutBeta) {
+                    SEARCH_STAT(STAT_PROBCUT_CUTOFF, depth);
+
+                    countTTWrite(ttWriter, pos.hash(), depth);
+                    ttWriter.write(
+                        pos.hash(),
+                        valueToTT(score, sPtr->ply),
+                        rawEval,
+                        probCutDepth,
+                        sPtr->ttPv,
+                        currentMove,
+                        tt.getAge(),
+                        BOUND_LOWER
+                    );
+
+                    return score;
+                }
+            }
+        }
+
         // Internal Iterative Reduction
         if (PvNode && !ttData.move) {
             depth -= Tunables::IIR_REDUCTION;
@@ -468,8 +590,17 @@ Value SearchWorker::pvSearch(
 
     score = bestScore;
 
+    // With several threads, the moves searched here are recorded in the
+    // searching table. At non-PV nodes, moves that another thread is already
+    // searching are put off until the others have been searched, by when
+    // their results may be in the TT.
+    const bool shareMoves = threads.size() > 1 && depth >= SHARE_MIN_DEPTH;
+    PartialMoveList deferred;
+    size_t nextDeferred = 0;
+
     // Search all the moves, stopping if beta cutoff occurs
-    while ((currentMove = mp.nextMove(skipQuiet)) != MOVE_NONE) {
+    while ((currentMove = mp.nextMove(skipQuiet)) != MOVE_NONE
+        || (nextDeferred < deferred.size() && (currentMove = deferred[nextDeferred++]) != MOVE_NONE)) {
 
         assert(isValidMove(currentMove));
         assert(pos.isPseudoLegalMove<Me>(currentMove));
@@ -480,10 +611,38 @@ Value SearchWorker::pvSearch(
             continue;
         }
 
+        if (currentMove == excludedMove) {
+            continue;
+        }
+
+        const bool isDeferred = nextDeferred > 0;
+
+        if constexpr (!PvNode) {
+            if (shareMoves && !isDeferred && nMoves > 0) {
+                ++thisThread->deferCandidates;
+
+                if (   deferred.size() < deferred.maxsize()
+                    && threads.searchingMoves.isSearching(pos.hashAfter(currentMove), depth)) {
+                    ++thisThread->deferredMoves;
+                    deferred.push_back(currentMove);
+                    continue;
+                }
+            }
+
+            // The move picker would no longer have given a put off quiet move
+            if (isDeferred && skipQuiet && !pos.isTactical(currentMove)) {
+                continue;
+            }
+        }
+
         sPtr->nMoves = ++nMoves;
 
-        if (RootNode && isFirstThread() && nodes > 1000000) {
-            Uci::callbackIter(depth, currentMove, nMoves);
+        if (RootNode && isFirstThread() && limits.currMoveInterval) {
+            const TimePoint t = now();
+            if (t - lastCurrMoveTime >= limits.currMoveInterval) {
+                lastCurrMoveTime = t;
+                Uci::callbackIter(depth, currentMove, nMoves);
+            }
         }
 
         if constexpr (PvNode) {
@@ -504,7 +663,9 @@ Value SearchWorker::pvSearch(
         // Late move pruning
         if (!RootNode && bestScore > VALUE_TB_LOSS_IN_MAX_PLY && pos.hasNonPawnMaterial<Me>()) {
 
-            skipQuiet = (nMoves >= ((3 + depth * depth) / (2 - improving)));
+            const bool lmp = nMoves >= ((3 + depth * depth) / (2 - improving));
+            if (lmp && !skipQuiet) SEARCH_STAT(STAT_LMP_PRUNE, depth);
+            skipQuiet = lmp;
 
             int lmpDepth = newDepth - reduction;
 
@@ -523,6 +684,7 @@ Value SearchWorker::pvSearch(
                         + captHist / Tunables::FUTILITY_PRUNING_CAPT_HIST_SCALE
                     ) <= alpha
                 ) {
+                    SEARCH_STAT(STAT_CAPTURE_FUTILITY_PRUNE, depth);
                     continue;
                 }
 
@@ -533,6 +695,7 @@ Value SearchWorker::pvSearch(
                     depth *  Tunables::FUTILITY_PRUNING_SEE_DEPTH_SCALE_MAX
                 );
                 if (!pos.see(currentMove, Tunables::FUTILITY_PRUNING_SEE_DEPTH_SCALE_THRESHOLD * depth - seeHist)) {
+                    SEARCH_STAT(STAT_SEE_PRUNE, depth);
                     continue;
                 }
             }
@@ -545,6 +708,7 @@ Value SearchWorker::pvSearch(
 
                 // Prune some moves if their history is bad
                 if (history < depth * Tunables::CONT_HIST_PRUNING_SCALE) {
+                    SEARCH_STAT(STAT_HISTORY_PRUNE, depth);
                     continue;
                 }
 
@@ -556,14 +720,60 @@ Value SearchWorker::pvSearch(
             }
         }
 
+        // Singular extensions.
+        // If the TT move scores well above every other move when those are
+        // searched to a reduced depth, it is singular: it gets searched deeper.
+        // If instead another move also beats beta, the node has several moves
+        // that fail high, so is cut off straight away (multi-cut).
+        if (   !RootNode
+            && currentMove == ttData.move
+            && !excludedMove
+            && depth >= Tunables::SE_MIN_DEPTH
+            && ttData.depth >= depth - Tunables::SE_TT_DEPTH_MARGIN
+            && (ttData.bound & BOUND_LOWER)
+            && std::abs(ttData.score) < VALUE_TB_WIN_IN_MAX_PLY
+        ) {
+            const Value singularBeta  = ttData.score - Tunables::SE_BETA_SCALE * depth / 64;
+            const Depth singularDepth = newDepth / 2;
+
+            SEARCH_STAT(STAT_SE_SEARCH, depth);
+
+            sPtr->excludedMove = currentMove;
+            score = pvSearch<Me, NODETYPE_NON_PV>(pos, sPtr, singularBeta - 1, singularBeta, singularDepth, cutNode);
+            sPtr->excludedMove = MOVE_NONE;
+
+            // The search reused this node's stack entry
+            sPtr->nMoves = nMoves;
+
+            if (score < singularBeta) {
+                SEARCH_STAT(STAT_SE_EXTEND, depth);
+                ++newDepth;
+            }
+
+            else if (singularBeta >= beta) {
+                SEARCH_STAT(STAT_MULTI_CUT, depth);
+                return singularBeta;
+            }
+
+            // The TT move is expected to fail high, but others might too
+            else if (ttData.score >= beta) {
+                newDepth -= 2;
+            }
+
+            score = bestScore;
+        }
+
         // Prefetch TT entry
-        tt.prefetch(pos.hashAfter(currentMove));
+        const Key childKey = pos.hashAfter(currentMove);
+        tt.prefetch(childKey);
 
         sPtr->currentMove = currentMove;
         sPtr->continuationHist = &thisThread->continuationHist[sPtr->inCheck][isCapture][movedPiece][moveTo(currentMove)];
 
         // Increment nodes
-        thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
+        thisThread->nodes.store(thisThread->nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        const bool recorded = shareMoves && threads.searchingMoves.enter(childKey, depth);
 
         // Make the move
         pos.doMove<Me>(currentMove);
@@ -599,11 +809,15 @@ Value SearchWorker::pvSearch(
 
             Depth d = std::max(1, std::min(newDepth - reduction, newDepth + 1));
 
+            SEARCH_STAT(STAT_LMR_SEARCH, depth);
+
             // Narrow search with reduced depth
             score = -pvSearch<~Me, NODETYPE_NON_PV>(pos, sPtr + 1, -alpha - 1, -alpha, d, true);
 
             // Do full depth search if LMR fails high
             if (score > alpha && d < newDepth) {
+                SEARCH_STAT(STAT_LMR_RESEARCH, depth);
+
                 // Narrow search with full depth
                 score = -pvSearch<~Me, NODETYPE_NON_PV>(pos, sPtr + 1, -alpha - 1, -alpha, newDepth - 1, !cutNode);
             }
@@ -631,6 +845,10 @@ Value SearchWorker::pvSearch(
         // Undo the move
         pos.undoMove<Me>(currentMove);
 
+        if (recorded) {
+            threads.searchingMoves.leave(childKey);
+        }
+
         assert(score > -VALUE_INFINITE && score < VALUE_INFINITE);
 
         // Check if the search has been aborted. If it has, this search cannot be
@@ -689,6 +907,8 @@ Value SearchWorker::pvSearch(
                 }
 
                 if (score >= beta) {
+                    SEARCH_STAT(STAT_FAIL_HIGH, depth);
+                    if (nMoves == 1) SEARCH_STAT(STAT_FAIL_HIGH_FIRST, depth);
                     break;
                 }
 
@@ -714,11 +934,13 @@ Value SearchWorker::pvSearch(
         }
     }
 
-    assert (nMoves || sPtr->inCheck || Movegen::countLegalMoves<Me>(pos) == 0);
+    assert (nMoves || excludedMove || sPtr->inCheck || Movegen::countLegalMoves<Me>(pos) == 0);
 
     // If there are no moves, we are in checkmate / stalemate
     if (!nMoves) {
-        bestScore = sPtr->inCheck ? -VALUE_MATE + sPtr->ply : VALUE_DRAW;
+        bestScore = excludedMove  ? alpha
+                  : sPtr->inCheck ? -VALUE_MATE + sPtr->ply
+                                  : VALUE_DRAW;
     }
 
     if (bestMove != MOVE_NONE) {
@@ -730,12 +952,18 @@ Value SearchWorker::pvSearch(
         bestScore = std::min(bestScore, maxScore);
     }
 
+    // Only the search of this node with every move may be stored
+    if (excludedMove) {
+        return bestScore;
+    }
+
     if (bestScore <= alpha) {
         // Opponent's last move was probably good
         sPtr->ttPv = sPtr->ttPv || ((sPtr - 1)->ttPv && depth > Tunables::PREVIOUS_POS_TTPV_MIN_DEPTH);
     }
 
     // Update TT
+    countTTWrite(ttWriter, pos.hash(), depth);
     ttWriter.write(
         pos.hash(),
         valueToTT(bestScore, sPtr->ply),
@@ -787,6 +1015,8 @@ Value SearchWorker::qSearch(
 
     SearchWorker* thisThread = this;
 
+    SEARCH_STAT(STAT_QNODES, 0);
+
     Move pv[MAX_PLY + 1];
 
     Value score, bestScore, rawEval = VALUE_NONE;
@@ -806,10 +1036,16 @@ Value SearchWorker::qSearch(
         thisThread->selDepth = sPtr->ply + 1;
     }
 
+    // Check for an upcoming repetition draw
+    if (alpha < VALUE_DRAW && pos.hasGameCycle(sPtr->ply)) {
+        alpha = VALUE_DRAW - 1 + (nodes & 0x2);
+        if (alpha >= beta) return alpha;
+    }
+
     // Check for draw or if we have reached MAX PLY
     if (pos.isDraw() || sPtr->ply >= MAX_PLY) {
         return (sPtr->ply >= MAX_PLY && !sPtr->inCheck)
-            ? Eval::evaluate<Me>(pos, networks, cacheTable, thisThread->optimism[Me])
+            ? Eval::evaluate<Me>(pos, networks, cacheTable, evalHash, thisThread->optimism[Me])
             : VALUE_DRAW;
     }
 
@@ -828,13 +1064,14 @@ Value SearchWorker::qSearch(
      && (ttData.depth >= qsTtDepth)
      && (ttData.bound & (ttData.score >= beta ? BOUND_LOWER : BOUND_UPPER))
     ) {
+        SEARCH_STAT(STAT_TT_CUTOFF, 0);
         return ttData.score;
     }
 
     // Static eval of position
     if (!sPtr->inCheck) {
         if (sPtr->ttHit) {
-            rawEval = (ttData.eval != VALUE_NONE ? ttData.eval : Eval::evaluate<Me>(pos, networks, cacheTable, thisThread->optimism[Me]));
+            rawEval = (ttData.eval != VALUE_NONE ? ttData.eval : Eval::evaluate<Me>(pos, networks, cacheTable, evalHash, thisThread->optimism[Me]));
             sPtr->staticEval = bestScore = correctStaticEval<Me>(rawEval, pos);
 
             // Use value from tt if possible
@@ -847,7 +1084,7 @@ Value SearchWorker::qSearch(
         } else {
 
             rawEval = (sPtr - 1)->currentMove != MOVE_NULL
-                    ? Eval::evaluate<Me>(pos, networks, cacheTable, thisThread->optimism[Me])
+                    ? Eval::evaluate<Me>(pos, networks, cacheTable, evalHash, thisThread->optimism[Me])
                     : -(sPtr - 1)->staticEval;
 
             sPtr->staticEval = bestScore = correctStaticEval<Me>(rawEval, pos);
@@ -861,6 +1098,7 @@ Value SearchWorker::qSearch(
 
             // Write to transposition table
             if (!sPtr->ttHit) {
+                countTTWrite(ttWriter, pos.hash(), 0);
                 ttWriter.write(
                     pos.hash(),
                     valueToTT(bestScore, sPtr->ply),
@@ -926,6 +1164,7 @@ Value SearchWorker::qSearch(
 
                 // Move count pruning
                 if (nMoves > 2) {
+                    SEARCH_STAT(STAT_LMP_PRUNE, 0);
                     continue;
                 }
 
@@ -934,18 +1173,21 @@ Value SearchWorker::qSearch(
                 // If static eval + value of piece we are going to capture
                 // is much lower than alpha, prune this move
                 if (futility <= alpha) {
+                    SEARCH_STAT(STAT_FUTILITY_PRUNE, 0);
                     bestScore = std::max(bestScore, futility);
                     continue;
                 }
 
                 // If static eval is worse than alpha and we don't win material, prune this move
                 if (futilityBase <= alpha && !pos.see(currentMove, 1)) {
+                    SEARCH_STAT(STAT_FUTILITY_PRUNE, 0);
                     bestScore = std::max(bestScore, futilityBase);
                     continue;
                 }
 
                 // If SEE eval is much worse than the alpha cutoff, we can prune this move
                 if (futilityBase > alpha && !pos.see(currentMove, (alpha - futilityBase) * Tunables::FUTILITY_SEE_PRUNING_MULTIPLIER)) {
+                    SEARCH_STAT(STAT_SEE_PRUNE, 0);
                     bestScore = alpha;
                     continue;
                 }
@@ -959,11 +1201,13 @@ Value SearchWorker::qSearch(
                 <= Tunables::CONT_HIST_PRUNNING_THRESHOLD
                 )
             ) {
+                SEARCH_STAT(STAT_HISTORY_PRUNE, 0);
                 continue;
             }
 
             // SEE pruning
             if (!pos.see(currentMove, -83)) {
+                SEARCH_STAT(STAT_SEE_PRUNE, 0);
                 continue;
             }
         }
@@ -975,7 +1219,7 @@ Value SearchWorker::qSearch(
         sPtr->continuationHist = &thisThread->continuationHist[sPtr->inCheck][pos.isTactical(currentMove)][pos.getPieceAt(moveFrom(currentMove))][moveTo(currentMove)];
 
         // Increment nodes
-        thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
+        thisThread->nodes.store(thisThread->nodes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
 
         // Recursive part
         pos.doMove<Me>(currentMove);
@@ -1003,6 +1247,8 @@ Value SearchWorker::qSearch(
 
                 // Fail high
                 else {
+                    SEARCH_STAT(STAT_FAIL_HIGH, 0);
+                    if (nMoves == 1) SEARCH_STAT(STAT_FAIL_HIGH_FIRST, 0);
                     break;
                 }
             }
@@ -1020,6 +1266,7 @@ Value SearchWorker::qSearch(
     }
 
     // Update TT
+    countTTWrite(ttWriter, pos.hash(), 0);
     ttWriter.write(
         pos.hash(),
         valueToTT(bestScore, sPtr->ply),
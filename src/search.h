@@ -3,14 +3,17 @@
 #include <atomic>
 #include <chrono>
 #include <cstdint>
+#include <span>
 #include <string_view>
 #include <thread>
 #include <vector>
 
+#include "evaluate.h"
 #include "movegen.h"
 #include "movepicker.h"
 #include "nnue/network.h"
 #include "nnue/nnue_accumulator.h"
+#include "searchstats.h"
 #include "tt.h"
 #include "tunables.h"
 #include "types.h"
@@ -67,26 +70,33 @@ struct SearchInfo {
     int selDepth;
     size_t timeSearched;
     size_t nodesSearched;
-    std::string_view pv;
-    std::string_view score;
+    std::span<const Move> pv;
+    Value score;
+    const Position* rootPos;    // Needed to convert the score to centipawns
     int hashFull;
     size_t tbHits;
 };
 
 
 
+// How many nodes the first thread searches between checks of the time
+constexpr int TIME_CHECK_INTERVAL = 1024;
+
+
 struct SearchLimits {
     SearchLimits() {
         time[WHITE] = time[BLACK] = TimePoint(0);
         inc[WHITE]  = inc[BLACK]  = TimePoint(0);
-        isInfinite = false;
+        isInfinite = isPonder = false;
         nodes = depth = mate = movesToGo = 0;
+        moveTime = currMoveInterval = 0;
     }
 
     std::vector<std::string> searchMoves;
     TimePoint time[COLOR_NB], inc[COLOR_NB];
     TimePoint startTimePoint, moveTime;
-    bool isInfinite;
+    TimePoint currMoveInterval;     // Minimum time between currmove lines (0 = never)
+    bool isInfinite, isPonder;
     uint64_t nodes;
     int depth, mate, movesToGo;
 };
@@ -95,17 +105,27 @@ struct SearchLimits {
 struct SearchWorkerShared {
     SearchWorkerShared(
         ThreadPool& threadPool,
-        NNUE::Networks& NNUEs,
-        TranspositionTable& tt
+        const NNUE::Networks& NNUEs,
+        TranspositionTable& tt,
+        std::span<const std::unique_ptr<NNUE::Networks>> replicas = {}
     ) :
         threads(threadPool),
         networks(NNUEs),
-        tt(tt)
+        tt(tt),
+        replicas(replicas)
     {}
 
+    // The copy of the networks kept on a NUMA node, or the originals if there is none
+    const NNUE::Networks& networksOn(int node) const {
+        return node >= 0 && size_t(node) < replicas.size() && replicas[node] ? *replicas[node] : networks;
+    }
+
     ThreadPool&             threads;
     const NNUE::Networks&   networks;
     TranspositionTable&     tt;
+
+    // Indexed by node
+    std::span<const std::unique_ptr<NNUE::Networks>> replicas;
 };
 
 
@@ -148,6 +168,7 @@ struct StackObject {
     Value   staticEval;
     Move    currentMove;
     Move    killer;
+    Move    excludedMove;   // Left out of the search of this node, while checking if it is singular
     bool    inCheck, ttHit, ttPv;
     int     statScore;
     int     nMoves;
@@ -177,7 +198,18 @@ public:
         Depth depth
     );
 
-    inline void reset() { this->nodes = this->tbHits = this->rootDepth = this->completedDepth = 0; }
+    inline void reset() {
+        this->nodes = this->tbHits = this->rootDepth = this->completedDepth = 0;
+        this->lastCurrMoveTime = limits.startTimePoint;
+        this->timeCheckCountdown = TIME_CHECK_INTERVAL;
+        this->evalHash.resetCounters();
+        this->deferCandidates = this->deferredMoves = 0;
+#ifdef SEARCH_STATS
+        this->stats.clear();
+        this->cacheTable.big.stats.clear();
+        this->cacheTable.small.stats.clear();
+#endif
+    }
 
 
     void startSearch();
@@ -186,11 +218,37 @@ public:
 
     inline uint64_t getNodes()  const { return nodes.load(std::memory_order_relaxed);  }
     inline uint64_t getTbHits() const { return tbHits.load(std::memory_order_relaxed); }
+    inline Depth    getCompletedDepth() const { return completedDepth; }
+
+    // The networks this worker evaluates with: the copy on its NUMA node, if there is one
+    inline const NNUE::Networks& getNetworks() const { return networks; }
+
+    inline uint64_t getDeferCandidates() const { return deferCandidates; }
+    inline uint64_t getDeferredMoves()   const { return deferredMoves;   }
+
+    inline uint64_t getEvalHashProbes() const { return evalHash.probes; }
+    inline uint64_t getEvalHashHits()   const { return evalHash.hits;   }
+
+    inline const NNUE::UpdateStats& getNnueStatsBig()   const { return cacheTable.big.stats;   }
+    inline const NNUE::UpdateStats& getNnueStatsSmall() const { return cacheTable.small.stats; }
 
     Search::SearchLimits limits;
     Position rootPosition;
     RootMoveList rootMoves;
 
+    // When this thread last started searching, for latencybench. This is read
+    // by the main thread while the search runs, so it is kept as an atomic tick count.
+    inline std::chrono::steady_clock::time_point getStartedAt() const {
+        return std::chrono::steady_clock::time_point(
+            std::chrono::steady_clock::duration(startedAt.load(std::memory_order_acquire)));
+    }
+
+    std::atomic<int64_t> startedAt = 0;
+
+#ifdef SEARCH_STATS
+    SearchStats stats;
+#endif
+
     // Histories
     Movepicker::ButterflyHistory        butterflyHist;
     Movepicker::CapturePieceToHistory   captureHist;
@@ -208,6 +266,8 @@ private:
     }
     template<Color Me> void iterativeDeepening();
 
+    void checkTime();
+
 
     template<Color Me, NodeType Nt>
     Value pvSearch(
@@ -230,21 +290,52 @@ private:
     }
 
 
+    // The fields below are grouped by who writes them, each group on its own
+    // cache lines, so that other threads reading one group do not keep taking
+    // the lines of another away from this thread.
+
+    // Only read once set up
     size_t   idx;
 
-    Depth    currentDepth, rootDepth, completedDepth, selDepth, nmpCutoff;
+    ThreadPool&             threads;
+    TranspositionTable&     tt;
+    const NNUE::Networks&   networks;
+
+    std::array<int, MAX_MOVE> reductions;
+
+    // Written by this thread while searching, and read by the other threads
+    // (the first one summing them up for info lines, or the UCI thread).
+    // Only this thread writes them, so no atomic increments are needed.
+    alignas(64) std::atomic<uint64_t> nodes;
+    std::atomic<uint64_t> tbHits;
+
+    // Written by this thread while searching, and read by others only once it has stopped
+    alignas(64) Depth currentDepth;
+    Depth    rootDepth, completedDepth, selDepth, nmpCutoff;
     Value    rootDelta;
 
     Value optimism[COLOR_NB];
 
-    std::array<int, MAX_MOVE> reductions;
+    TimePoint lastCurrMoveTime;
 
-    ThreadPool&             threads;
-    TranspositionTable&     tt;
-    const NNUE::Networks&   networks;
-    NNUE::AccumulatorCaches cacheTable;
+    // Nodes until the first thread next checks the time
+    int timeCheckCountdown;
 
-    std::atomic<uint64_t> nodes, tbHits;
+    // Counts a TT write for the search statistics, and whether it stores a
+    // position not yet stored this search
+    inline void countTTWrite([[maybe_unused]] const TTWriter& writer, [[maybe_unused]] Key key, [[maybe_unused]] Depth depth) {
+#ifdef SEARCH_STATS
+        SEARCH_STAT(STAT_TT_WRITE, depth);
+        if (writer.isNew(key, tt.getAge())) SEARCH_STAT(STAT_TT_NEW_WRITE, depth);
+#endif
+    }
+
+    // Moves that could have been put off because another thread was searching
+    // them, and those that were
+    uint64_t deferCandidates, deferredMoves;
+
+    NNUE::AccumulatorCaches cacheTable;
+    Eval::EvalHash          evalHash;
 
     // TODO: Could move these into history struct?
 
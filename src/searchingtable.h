@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "tt.h"
+#include "types.h"
+
+namespace Atom {
+
+// The moves the search threads are searching right now, used to keep them
+// from searching the same subtree at the same time (as in ABDADA).
+// Each entry holds the hash of the position after a move, and the depth the
+// move is being searched to. An entry is claimed when the search of a move
+// starts and freed when it ends. This is lock-free and may be racy: if two
+// moves share an entry, the second is simply not recorded.
+class SearchingTable {
+public:
+    SearchingTable() : entries(std::make_unique<Entry[]>(SIZE)) {}
+
+    // Whether some thread is searching the position to at least this depth
+    inline bool isSearching(Key key, Depth depth) const {
+        const Entry& entry = entries[index(key)];
+        return entry.key.load(std::memory_order_relaxed) == key
+            && entry.depth.load(std::memory_order_relaxed) >= depth;
+    }
+
+    // Records that the calling thread is searching the position. Returns whether
+    // it was recorded, in which case it must be left once the search is done.
+    inline bool enter(Key key, Depth depth) {
+        Entry& entry = entries[index(key)];
+        Key empty = 0;
+
+        if (!entry.key.compare_exchange_strong(empty, key, std::memory_order_relaxed))
+            return false;
+
+        entry.depth.store(depth, std::memory_order_relaxed);
+        return true;
+    }
+
+    inline void leave(Key key) {
+        entries[index(key)].key.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t SIZE = 1 << 14;
+
+    struct Entry {
+        std::atomic<Key>   key   = 0;
+        std::atomic<Depth> depth = 0;
+    };
+
+    static inline size_t index(Key key) { return key & (SIZE - 1); }
+
+    std::unique_ptr<Entry[]> entries;
+};
+
+} // namespace Atom
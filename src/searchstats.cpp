@@ -0,0 +1,66 @@
+#include <iomanip>
+#include <sstream>
+
+#include "searchstats.h"
+
+namespace Atom {
+
+namespace Search {
+
+constexpr const char* STAT_NAMES[STAT_NB] = {
+    "nodes", "qnodes", "ttcut", "nmp", "nmpcut", "pc", "pccut", "rfp", "razor", "fut",
+    "lmp", "capfut", "see", "hist", "lmr", "relmr", "fh", "fh1st",
+    "se", "seext", "multicut", "ttw", "ttwnew"
+};
+
+
+// Formats the statistics as a table with one row per depth, followed by
+// the rates we care about most when tuning.
+std::string SearchStats::table() const {
+    std::stringstream ss;
+
+    std::array<uint64_t, STAT_NB> total = {};
+
+    ss << std::setw(5) << "depth";
+    for (const char* name : STAT_NAMES) ss << std::setw(11) << name;
+    ss << std::endl;
+
+    for (int d = 0; d < STATS_MAX_DEPTH; ++d) {
+        bool empty = true;
+        for (int s = 0; s < STAT_NB; ++s) {
+            total[s] += counts[d][s];
+            empty    &= !counts[d][s];
+        }
+
+        if (empty) continue;
+
+        ss << std::setw(5) << d;
+        for (int s = 0; s < STAT_NB; ++s) ss << std::setw(11) << counts[d][s];
+        ss << std::endl;
+    }
+
+    ss << std::setw(5) << "all";
+    for (int s = 0; s < STAT_NB; ++s) ss << std::setw(11) << total[s];
+    ss << std::endl << std::endl;
+
+    auto rate = [&](SearchStat num, uint64_t denom) {
+        return denom ? 100.0 * total[num] / denom : 0.0;
+    };
+
+    ss << std::fixed << std::setprecision(1);
+    ss << "qsearch share:         " << rate(STAT_QNODES, total[STAT_NODES] + total[STAT_QNODES]) << "%" << std::endl;
+    ss << "TT cutoffs per node:   " << rate(STAT_TT_CUTOFF, total[STAT_NODES] + total[STAT_QNODES]) << "%" << std::endl;
+    ss << "Null move success:     " << rate(STAT_NMP_CUTOFF, total[STAT_NMP_TRIED]) << "%" << std::endl;
+    ss << "ProbCut success:       " << rate(STAT_PROBCUT_CUTOFF, total[STAT_PROBCUT_TRIED]) << "%" << std::endl;
+    ss << "LMR re-searches:       " << rate(STAT_LMR_RESEARCH, total[STAT_LMR_SEARCH]) << "%" << std::endl;
+    ss << "First move fail highs: " << rate(STAT_FAIL_HIGH_FIRST, total[STAT_FAIL_HIGH]) << "%" << std::endl;
+    ss << "Singular TT moves:     " << rate(STAT_SE_EXTEND, total[STAT_SE_SEARCH]) << "%" << std::endl;
+    ss << "Multi-cuts:            " << rate(STAT_MULTI_CUT, total[STAT_SE_SEARCH]) << "%" << std::endl;
+    ss << "New TT writes:         " << rate(STAT_TT_NEW_WRITE, total[STAT_TT_WRITE]) << "%" << std::endl;
+
+    return ss.str();
+}
+
+} // namespace Search
+
+} // namespace Atom
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace Atom {
+
+namespace Search {
+
+// Counters of what happens during search, kept per thread and per depth.
+// These are only compiled in with -DSEARCH_STATS (see "make stats"), so
+// normal builds pay nothing for them.
+enum SearchStat {
+    STAT_NODES,             // pvSearch nodes
+    STAT_QNODES,            // qSearch nodes
+    STAT_TT_CUTOFF,
+    STAT_NMP_TRIED,
+    STAT_NMP_CUTOFF,
+    STAT_PROBCUT_TRIED,     // Captures searched by ProbCut
+    STAT_PROBCUT_CUTOFF,
+    STAT_RFP_PRUNE,
+    STAT_RAZOR_PRUNE,
+    STAT_FUTILITY_PRUNE,    // Whole node in pvSearch, single moves in qSearch
+    STAT_LMP_PRUNE,         // Times the remaining quiets were skipped
+    STAT_CAPTURE_FUTILITY_PRUNE,
+    STAT_SEE_PRUNE,
+    STAT_HISTORY_PRUNE,
+    STAT_LMR_SEARCH,
+    STAT_LMR_RESEARCH,
+    STAT_FAIL_HIGH,
+    STAT_FAIL_HIGH_FIRST,   // Fail highs on the first move searched
+    STAT_SE_SEARCH,         // Singular extension verification searches
+    STAT_SE_EXTEND,         // TT moves found singular, and extended
+    STAT_MULTI_CUT,
+    STAT_TT_WRITE,
+    STAT_TT_NEW_WRITE,      // Writes of a position the TT did not yet hold from this search
+
+    STAT_NB
+};
+
+// qSearch is counted at depth 0, and pvSearch at its remaining depth.
+constexpr int STATS_MAX_DEPTH = 64;
+
+struct SearchStats {
+    std::array<std::array<uint64_t, STAT_NB>, STATS_MAX_DEPTH> counts;
+
+    inline void clear() { counts = {}; }
+
+    inline void increment(SearchStat stat, int depth) {
+        ++counts[depth < 0 ? 0 : depth < STATS_MAX_DEPTH ? depth : STATS_MAX_DEPTH - 1][stat];
+    }
+
+    inline void add(const SearchStats& other) {
+        for (int d = 0; d < STATS_MAX_DEPTH; ++d)
+            for (int s = 0; s < STAT_NB; ++s)
+                counts[d][s] += other.counts[d][s];
+    }
+
+    inline uint64_t total(SearchStat stat) const {
+        uint64_t sum = 0;
+        for (int d = 0; d < STATS_MAX_DEPTH; ++d) sum += counts[d][stat];
+        return sum;
+    }
+
+    std::string table() const;
+};
+
+} // namespace Search
+
+
+#ifdef SEARCH_STATS
+#define SEARCH_STAT(stat, depth) stats.increment(Search::stat, depth)
+#else
+#define SEARCH_STAT(stat, depth) ((void)0)
+#endif
+
+} // namespace Atom
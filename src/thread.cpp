@@ -1,66 +1,193 @@
+#include <algorithm>
+#include <climits>
 #include <cstdint>
+#include <cstdlib>
+#include <functional>
 #include <memory>
-#include <mutex>
+#include <unordered_map>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 #include "thread.h"
 #include "movegen.h"
+#include "numa.h"
 #include "search.h"
+#include "trace.h"
 #include "types.h"
 
 namespace Atom {
 
+namespace {
+
+// Roughly 0.1-0.5 ms, depending on how long the CPU pauses for
+constexpr int SPIN_ITERATIONS = 1 << 13;
+
+constexpr uint32_t WAKE_ALL = ~0u;
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t)
+           && std::atomic<uint32_t>::is_always_lock_free, "Futex words must be plain 32 bit integers");
+
+inline void cpuPause() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+// Sleeps while word is expected, unless woken with a mask sharing a bit with mask.
+// Can return spuriously.
+void futexWait(std::atomic<uint32_t>& word, uint32_t expected, uint32_t mask) {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_BITSET_PRIVATE,
+            expected, nullptr, nullptr, mask);
+#else
+    (void)mask;
+    word.wait(expected, std::memory_order_acquire);
+#endif
+}
+
+// Wakes every thread sleeping on word whose mask shares a bit with mask
+void futexWake(std::atomic<uint32_t>& word, uint32_t mask) {
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_BITSET_PRIVATE,
+            INT_MAX, nullptr, nullptr, mask);
+#else
+    (void)mask;
+    word.notify_all();
+#endif
+}
+
+// Returns once word is no longer value: spins for a while first, as the
+// wait is often short, then sleeps.
+void waitWhile(std::atomic<uint32_t>& word, uint32_t value, uint32_t mask, int spins) {
+    for (int i = 0; i < spins; ++i) {
+        if (word.load(std::memory_order_acquire) != value) return;
+        cpuPause();
+    }
+
+    while (word.load(std::memory_order_acquire) == value)
+        futexWait(word, value, mask);
+}
+
+} // namespace
+
+
+Thread::Thread(
+    size_t index,
+    Search::SearchWorkerShared& sharedState,
+    int cpu
+) :
+    idx(index),
+    pool(sharedState.threads),
+    cpu(cpu),
+    searching(1),
+    thread(&Thread::run, this, std::ref(sharedState))
+{
+    // Wait for the worker to be created
+    waitForFinish();
+}
+
+
 Thread::~Thread() {
-    shouldExit = true;
-    search();
+    waitForFinish();
+    post(Job::EXIT);
+    pool.wake(wakeMask());
     thread.join();
 }
 
-void Thread::search() {
-    std::unique_lock<std::mutex> lock(mutex);
-    cv.wait(lock, [&] { return !searching; });
-    jobFunction = std::move([this]() { worker->startSearch(); });
-    searching = true;
 
-    cv.notify_one();
+uint32_t Thread::wakeMask() const {
+    return idx == 0 ? ThreadPool::WAKE_FIRST : ThreadPool::WAKE_HELPERS;
 }
 
 
-void Thread::clear() {
-    std::unique_lock<std::mutex> lock(mutex);
-    cv.wait(lock, [&] { return !searching; });
-    jobFunction = std::move([this]() { worker->clear(); });
-    searching = true;
+void Thread::post(Job newJob) {
+    assert(!searching.load(std::memory_order_relaxed));
 
-    cv.notify_one();
+    searching.store(1, std::memory_order_relaxed);
+    job.store(newJob, std::memory_order_release);
 }
 
 
-void Thread::idle() {
-    while (true) {
-        searching = false;
-        std::unique_lock<std::mutex> lock(mutex);
-        cv.notify_one();
-        // Wait until some other thread starts searching
-        cv.wait(lock, [&] { return searching; });
+void Thread::search() {
+    waitForFinish();
+    post(Job::SEARCH);
+    pool.wake(wakeMask());
+}
+
 
-        if (shouldExit) return;
+void Thread::run(Search::SearchWorkerShared& sharedState) {
+    if (cpu >= 0 && !Numa::bindThisThread(cpu))
+        cpu = -1;
 
-        std::function<void()> job = std::move(jobFunction);
-        jobFunction = nullptr;
+    // The worker is allocated and cleared by the thread that uses it, so that
+    // once bound, its memory is first touched on, and so placed on, its own node.
+    // It evaluates with the copy of the networks on that node, if there is one.
+    Search::SearchWorkerShared local(
+        sharedState.threads,
+        sharedState.networksOn(cpu >= 0 ? Numa::nodeOf(cpu) : -1),
+        sharedState.tt
+    );
+    worker = std::make_unique<Search::SearchWorker>(local, idx);
 
-        lock.unlock();
+    searching.store(0, std::memory_order_release);
+    futexWake(searching, WAKE_ALL);
 
-        if (job) {
-            job();
+    idle();
+}
+
+
+void Thread::idle() {
+    while (true) {
+        // Read the generation before the job: a job posted after this
+        // changes the generation, so the wait below cannot miss it.
+        const uint32_t seen = pool.generation.load(std::memory_order_acquire);
+        const Job current   = job.exchange(Job::NONE, std::memory_order_acquire);
+
+        if (current == Job::NONE) {
+            TRACE_SCOPE("Thread::idle");
+            waitWhile(pool.generation, seen, wakeMask(), pool.spinIterations);
+            continue;
+        }
+
+        if (current == Job::EXIT) return;
+
+        switch (current) {
+        case Job::SEARCH:
+            setupWorker(pool.searchPosition, pool.searchRootMoves, pool.searchLimits);
+            worker->startSearch();
+            break;
+        case Job::CLEAR:
+            worker->clear();
+            break;
+        case Job::CLEAR_TT:
+            pool.ttToClear->clearPart(idx, pool.size());
+            break;
+        case Job::TASK:
+            pool.task(*this);
+            break;
+        default:
+            break;
         }
+
+        searching.store(0, std::memory_order_release);
+        futexWake(searching, WAKE_ALL);
     }
 }
 
 
 void Thread::waitForFinish() {
-    std::unique_lock<std::mutex> lock(mutex);
-    // Wait until other threads are no longer searching
-    cv.wait(lock, [&]{ return !searching; });
+    TRACE_SCOPE("Thread::waitForFinish");
+    waitWhile(searching, 1, WAKE_ALL, pool.spinIterations);
+}
+
+
+void ThreadPool::wake(uint32_t mask) {
+    generation.fetch_add(1, std::memory_order_release);
+    futexWake(generation, mask);
 }
 
 
@@ -69,10 +196,12 @@ void ThreadPool::go(
     Position& pos,
     Search::SearchLimits limits
 ) {
+    TRACE_SCOPE("ThreadPool::go");
 
     firstThread()->waitForFinish();
 
     shouldStop = abortSearch = false;
+    ponder = limits.isPonder;
 
     Search::RootMoveList rootMoves;
 
@@ -82,12 +211,16 @@ void ThreadPool::go(
         return true;
     });
 
-    // Setup threads to be ready to search
+    // Each thread sets its worker up from these once it is woken, so the
+    // copying is done in parallel rather than here.
     for (std::unique_ptr<Thread>& thread : threads) {
         thread->waitForFinish();
-        thread->setupWorker(pos, rootMoves, limits);
     }
 
+    searchPosition  = pos;
+    searchRootMoves = rootMoves;
+    searchLimits    = limits;
+
     // Start first thread searching, this will notify the others.
     firstThread()->search();
 }
@@ -97,13 +230,17 @@ void ThreadPool::go(
 // This should only be invoked once, by the main thread.
 void ThreadPool::startSearching() {
 
+    // First thread has called all the other threads: it is
+    // already searching. Give all other threads their job, then
+    // wake them together.
     for (std::unique_ptr<Thread>& thread : threads) {
-        // First thread has called all the other threads: it is
-        // already searching. Call all other threads.
-        if (!(thread->id() == 0)) {
-            thread->search();
+        if (thread->id() != 0) {
+            thread->waitForFinish();
+            thread->post(Job::SEARCH);
         }
     }
+
+    wake(WAKE_HELPERS);
 }
 
 
@@ -115,19 +252,59 @@ void ThreadPool::waitForFinish() {
 }
 
 
-// Clear all the threads in the threadpool.
-void ThreadPool::clearThreads() {
-    if (threads.size() == 0) return;
+// Only stops the threads: clearing them would touch the networks, which the
+// engine may already have destroyed.
+ThreadPool::~ThreadPool() {
+    if (!threads.empty()) {
+        firstThread()->waitForFinish();
+        threads.clear();
+    }
+}
+
+
+void ThreadPool::runOnAll(Job job) {
+    for (std::unique_ptr<Thread>& thread : threads) {
+        thread->waitForFinish();
+        thread->post(job);
+    }
+
+    wake(WAKE_ALL);
 
-    for (std::unique_ptr<Thread>& thread: threads) {
-        thread->clear();
+    for (std::unique_ptr<Thread>& thread : threads) {
         thread->waitForFinish();
     }
+}
+
+
+// Clear all the threads in the threadpool. Each thread clears its own worker,
+// all at the same time, so that its memory stays on its own node.
+void ThreadPool::clearThreads() {
+    if (threads.size() == 0) return;
+
+    runOnAll(Job::CLEAR);
 
     // TODO: Clear time manager here
 }
 
 
+void ThreadPool::clearTT(TranspositionTable& tt) {
+    if (threads.empty()) {
+        tt.clear();
+        return;
+    }
+
+    ttToClear = &tt;
+    runOnAll(Job::CLEAR_TT);
+}
+
+
+void ThreadPool::runTask(std::function<void(Thread&)> newTask) {
+    task = std::move(newTask);
+    runOnAll(Job::TASK);
+    task = nullptr;
+}
+
+
 // Set the number of threads to the specified value
 void ThreadPool::setNbThreads(size_t nbThreads, Search::SearchWorkerShared sharedState) {
     // Wait for existing threads to finish
@@ -140,41 +317,76 @@ void ThreadPool::setNbThreads(size_t nbThreads, Search::SearchWorkerShared share
         return;
     }
 
+    // Spinning only helps if the threads are not taking cores from each other
+    spinIterations = nbThreads < std::thread::hardware_concurrency() ? SPIN_ITERATIONS : 0;
+
+    const std::vector<int> cpus = Numa::plan(binding, nbThreads);
+
     for (size_t i = 0; i < nbThreads; ++i) {
-        threads.emplace_back(std::make_unique<Thread>(i, sharedState));
+        threads.emplace_back(std::make_unique<Thread>(i, sharedState, cpus[i]));
     }
 }
 
 
+// Picks the thread whose result to play. Each thread votes for its best move,
+// weighted by how deep it got and how much better its score is than the
+// worst thread's, and the best thread is the one whose move got the most
+// votes. Proven wins and losses (mates and tablebase results) are handled on
+// their own: the shortest win is always taken, and a proven loss is only
+// played if every thread has one.
 Thread* ThreadPool::bestThread() const {
 
     // If we only have one thread, return it
     if (threads.size() == 1) { return firstThread(); }
 
-    Thread* bestThread = firstThread();
+    auto bestMove = [](Thread* thread) { return thread->worker->getRootMove(0).pv[0]; };
+    auto score    = [](Thread* thread) { return thread->worker->getRootMove(0).score; };
 
-    for (const std::unique_ptr<Thread>& newThread : threads) {
-        const Value maxScore = bestThread->worker->getRootMove(0).score;
-        const Depth maxDepth = bestThread->worker->getRootMove(0).selDepth;
+    // Threads that have not finished an iteration have nothing to vote with
+    std::vector<Thread*> voters;
+    for (const std::unique_ptr<Thread>& thread : threads) {
+        if (thread->worker->getCompletedDepth() > 0) voters.push_back(thread.get());
+    }
 
-        const Value newScore = newThread->worker->getRootMove(0).score;
-        const Depth newDepth = newThread->worker->getRootMove(0).selDepth;
+    if (voters.empty()) { return firstThread(); }
 
-        // If thread has an equal depth and greater score (or possible mate) it is better.
-        if ((newScore > maxScore)
-        &&  (newDepth == maxDepth || newScore > VALUE_MATE_IN_MAX_PLY)) {
-            bestThread = newThread.get();
-        }
+    Value minScore = VALUE_INFINITE;
+    for (Thread* thread : voters) {
+        minScore = std::min(minScore, score(thread));
+    }
 
-        // If thread has a greater depth + score (without replacing a closer mate) it is better.
-        if ((newDepth > maxDepth)
-        && (newScore > maxScore || maxScore < VALUE_MATE_IN_MAX_PLY)) {
-            bestThread = newThread.get();
-        }
+    auto weight = [&](Thread* thread) {
+        return int64_t(score(thread) - minScore + 14) * thread->worker->getCompletedDepth();
+    };
+
+    std::unordered_map<Move, int64_t> votes;
+    for (Thread* thread : voters) {
+        votes[bestMove(thread)] += weight(thread);
+    }
+
+    Thread* best = voters.front();
+
+    for (Thread* thread : voters) {
+        const Value bestScore = score(best);
+        const Value newScore  = score(thread);
+
+        if (std::abs(bestScore) >= VALUE_TB_WIN_IN_MAX_PLY) {
+            // Take the shortest win, or put off a proven loss for as long as possible
+            if (newScore > bestScore) best = thread;
+
+        } else if (newScore >= VALUE_TB_WIN_IN_MAX_PLY) {
+            best = thread;
+
+        } else if (newScore > VALUE_TB_LOSS_IN_MAX_PLY) {
+            const int64_t bestVotes = votes[bestMove(best)];
+            const int64_t newVotes  = votes[bestMove(thread)];
 
+            if (newVotes > bestVotes || (newVotes == bestVotes && weight(thread) > weight(best)))
+                best = thread;
+        }
     }
 
-    return bestThread;
+    return best;
 }
 
 
@@ -187,6 +399,72 @@ uint64_t ThreadPool::totalNodesSearched() const {
 }
 
 
+uint64_t ThreadPool::totalDeferCandidates() const {
+    uint64_t sum = 0;
+    for (const std::unique_ptr<Thread>& thread : threads) {
+        sum += thread->worker->getDeferCandidates();
+    }
+    return sum;
+}
+
+
+uint64_t ThreadPool::totalDeferredMoves() const {
+    uint64_t sum = 0;
+    for (const std::unique_ptr<Thread>& thread : threads) {
+        sum += thread->worker->getDeferredMoves();
+    }
+    return sum;
+}
+
+
+uint64_t ThreadPool::totalEvalHashProbes() const {
+    uint64_t sum = 0;
+    for (const std::unique_ptr<Thread>& thread : threads) {
+        sum += thread->worker->getEvalHashProbes();
+    }
+    return sum;
+}
+
+
+uint64_t ThreadPool::totalEvalHashHits() const {
+    uint64_t sum = 0;
+    for (const std::unique_ptr<Thread>& thread : threads) {
+        sum += thread->worker->getEvalHashHits();
+    }
+    return sum;
+}
+
+
+#ifdef SEARCH_STATS
+Search::SearchStats ThreadPool::totalStats() const {
+    Search::SearchStats sum;
+    sum.clear();
+    for (const std::unique_ptr<Thread>& thread : threads) {
+        sum.add(thread->worker->stats);
+    }
+    return sum;
+}
+
+
+NNUE::UpdateStats ThreadPool::totalNnueStatsBig() const {
+    NNUE::UpdateStats sum{};
+    for (const std::unique_ptr<Thread>& thread : threads) {
+        sum.add(thread->worker->getNnueStatsBig());
+    }
+    return sum;
+}
+
+
+NNUE::UpdateStats ThreadPool::totalNnueStatsSmall() const {
+    NNUE::UpdateStats sum{};
+    for (const std::unique_ptr<Thread>& thread : threads) {
+        sum.add(thread->worker->getNnueStatsSmall());
+    }
+    return sum;
+}
+#endif
+
+
 uint64_t ThreadPool::totalTbHits() const {
     uint64_t sum = 0;
     for (const std::unique_ptr<Thread>& thread : threads) {
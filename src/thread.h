@@ -1,46 +1,58 @@
 #pragma once
 
 #include <atomic>
-#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
-#include <mutex>
 #include <thread>
 #include <vector>
 
+#include "numa.h"
 #include "search.h"
+#include "searchingtable.h"
 
 namespace Atom {
 
 constexpr size_t NB_THREADS_DEFAULT = 1;
+constexpr size_t NB_THREADS_MAX     = 16;
+
+class ThreadPool;
+
+// The work a thread can be given. A job is handed over by storing it in the
+// thread and waking it, so starting a search never allocates.
+enum class Job : uint32_t {
+    NONE,
+    SEARCH,
+    CLEAR,
+    CLEAR_TT,
+    TASK,       // Runs ThreadPool::task
+    EXIT,
+};
+
 
 class Thread {
 public:
     Thread(
         size_t index,
-        Search::SearchWorkerShared& sharedState
-    ) :
-        idx(index),
-        thread(&Thread::idle, this)
-    {
-        worker = std::make_unique<Search::SearchWorker>(sharedState, index);
-    }
+        Search::SearchWorkerShared& sharedState,
+        int cpu
+    );
 
     virtual ~Thread();
 
     void search();
-    void clear();
     void idle();
 
     void waitForFinish();
-    bool isSearching() { return searching; }
+    bool isSearching() { return searching.load(std::memory_order_acquire); }
 
     size_t id() const { return idx; }
 
+    // The CPU the thread is bound to, or -1 if it is not
+    int boundCpu() const { return cpu; }
+
     std::unique_ptr<Search::SearchWorker> worker;
-    std::function<void()> jobFunction;
 
     void setupWorker(
         const Position& rootPosition,
@@ -54,14 +66,30 @@ public:
     }
 
 private:
+    friend class ThreadPool;
+
+    // The thread's entry point: binds it, creates its worker, then idles
+    void run(Search::SearchWorkerShared& sharedState);
+
+    // Gives the thread a job. It must be idle, and the caller must then wake it.
+    void post(Job newJob);
+
+    // The threads woken along with this one: the first thread is woken on its
+    // own, the helpers all at once.
+    uint32_t wakeMask() const;
+
     size_t idx;
+    ThreadPool& pool;
+    int cpu;
 
-    std::mutex              mutex;
-    std::condition_variable cv;
-    std::thread             thread;
+    std::atomic<Job> job = Job::NONE;
 
-    bool shouldExit = false;
-    bool searching  = true;
+    // 1 from when a job is posted until it is done
+    std::atomic<uint32_t> searching = 0;
+
+    // Declared last: run() starts running as soon as this is constructed,
+    // so everything it touches must be initialized before it.
+    std::thread             thread;
 };
 
 
@@ -71,7 +99,7 @@ public:
 
     // Constructor / destructor
     ThreadPool() {}
-    ~ThreadPool() { clearThreads(); }
+    ~ThreadPool();
 
     // ThreadPool cannot be copied
     ThreadPool(const ThreadPool &)            = delete;
@@ -81,8 +109,21 @@ public:
 
     // UCI commands
     void clearThreads();
+
+    // Clears the table with every thread clearing a part of it, which also
+    // spreads its pages over the threads' nodes when it has just been allocated
+    void clearTT(TranspositionTable& tt);
     void setNbThreads(size_t nbThreads, Search::SearchWorkerShared sharedState);
 
+    // Runs task on every thread at once, each passing itself, and waits for
+    // all of them. For work other than searching that should still run bound
+    // to the threads' CPUs, with their networks.
+    void runTask(std::function<void(Thread&)> newTask);
+
+    // Takes effect the next time the threads are created
+    void setBinding(const Numa::Binding& newBinding) { binding = newBinding; }
+    const Numa::Binding& getBinding() const { return binding; }
+
     // Start / stop searching
     void go(
         Position& pos,
@@ -107,12 +148,57 @@ public:
     // Get info from threads
     uint64_t totalNodesSearched() const;
     uint64_t totalTbHits() const;
+    uint64_t totalEvalHashProbes() const;
+    uint64_t totalEvalHashHits() const;
+    uint64_t totalDeferCandidates() const;
+    uint64_t totalDeferredMoves() const;
+#ifdef SEARCH_STATS
+    Search::SearchStats totalStats() const;
+    NNUE::UpdateStats   totalNnueStatsBig() const;
+    NNUE::UpdateStats   totalNnueStatsSmall() const;
+#endif
 
     // Stop variable
     std::atomic_bool shouldStop;
     std::atomic_bool abortSearch;
 
+    // Set while searching the expected reply, until ponderhit
+    std::atomic_bool ponder;
+
+    // The moves being searched by any thread
+    SearchingTable searchingMoves;
+
+    // Wake masks for the threads parked on generation
+    static constexpr uint32_t WAKE_FIRST   = 1;
+    static constexpr uint32_t WAKE_HELPERS = 2;
+
 private:
+    friend class Thread;
+
+    // Wakes the idle threads in mask, so they pick up the jobs posted to them
+    void wake(uint32_t mask);
+
+    // Gives every thread the same job, wakes them together, then waits for all of them
+    void runOnAll(Job job);
+
+    TranspositionTable* ttToClear = nullptr;
+    std::function<void(Thread&)> task;
+
+    // What the threads set their workers up with when they start searching
+    Position             searchPosition;
+    Search::RootMoveList searchRootMoves;
+    Search::SearchLimits searchLimits;
+
+    // Idle threads park on this with a futex, and are woken by incrementing it.
+    // Kept on its own cache line, as every idle thread may be spinning on it.
+    alignas(64) std::atomic<uint32_t> generation = 0;
+
+    // How long threads spin before parking: only when they have a core each
+    int spinIterations = 0;
+
+    Numa::Binding binding;
+
+    // Declared last, so the threads are destroyed before what they use
     ThreadList threads;
 };
 
@@ -0,0 +1,80 @@
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "trace.h"
+
+namespace Atom {
+
+namespace Trace {
+
+namespace {
+
+const auto startTime = std::chrono::steady_clock::now();
+
+// Buffers are owned here rather than by their threads, so the events of
+// threads that have since exited (e.g. after a change of thread count)
+// can still be written out.
+std::mutex buffersMutex;
+std::vector<std::unique_ptr<Buffer>> buffers;
+
+// Chrome trace timestamps are in microseconds
+void writeMicroseconds(std::ostream& os, uint64_t ns) {
+    os << ns / 1000 << "." << std::setw(3) << std::setfill('0') << ns % 1000 << std::setfill(' ');
+}
+
+} // namespace
+
+
+uint64_t timestamp() {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now() - startTime).count();
+}
+
+
+Buffer& threadBuffer() {
+    thread_local Buffer* buffer = nullptr;
+
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        buffers.push_back(std::make_unique<Buffer>());
+        buffer = buffers.back().get();
+        buffer->tid = int(buffers.size()) - 1;
+    }
+
+    return *buffer;
+}
+
+
+size_t writeChromeJson(std::ostream& os) {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+
+    size_t count = 0;
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+    for (const std::unique_ptr<Buffer>& buffer : buffers) {
+        const uint64_t written = buffer->written.load(std::memory_order_acquire);
+        const uint64_t first   = written > Buffer::SIZE ? written - Buffer::SIZE : 0;
+
+        for (uint64_t i = first; i < written; ++i) {
+            const Event& e = buffer->events[i & (Buffer::SIZE - 1)];
+
+            os << (count++ ? ",\n" : "\n")
+               << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+               << ",\"ts\":";
+            writeMicroseconds(os, e.start);
+            os << ",\"dur\":";
+            writeMicroseconds(os, e.duration);
+            os << "}";
+        }
+    }
+
+    os << "\n]}" << std::endl;
+    return count;
+}
+
+} // namespace Trace
+
+} // namespace Atom
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+namespace Atom {
+
+namespace Trace {
+
+// A lightweight tracer for seeing where wall clock time goes across threads.
+// Each thread records the scopes it completes into its own ring buffer, so
+// recording takes no locks; once the buffer is full the oldest events are
+// overwritten. Tracing is only compiled in with -DENABLE_TRACING (see
+// "make trace"), otherwise TRACE_SCOPE expands to nothing.
+
+struct Event {
+    const char* name;   // Must have static storage duration
+    uint64_t start;     // Nanoseconds since the tracer started
+    uint64_t duration;  // Nanoseconds
+};
+
+struct Buffer {
+    static constexpr size_t SIZE = 1 << 16;
+    static_assert((SIZE & (SIZE - 1)) == 0, "SIZE must be a power of 2");
+
+    int tid;
+    std::array<Event, SIZE> events;
+    std::atomic<uint64_t> written = 0;
+
+    inline void record(const char* name, uint64_t start, uint64_t end) {
+        const uint64_t w = written.load(std::memory_order_relaxed);
+        events[w & (SIZE - 1)] = {name, start, end - start};
+        written.store(w + 1, std::memory_order_release);
+    }
+};
+
+// Nanoseconds since the tracer started
+uint64_t timestamp();
+
+// The calling thread's buffer, created on first use
+Buffer& threadBuffer();
+
+// Writes every buffered event as Chrome trace event JSON, which can be
+// opened in chrome://tracing or Perfetto. Returns the number of events.
+// The threads being traced should be idle while this runs.
+size_t writeChromeJson(std::ostream& os);
+
+// Records the time from its construction to its destruction
+class Scope {
+public:
+    explicit Scope(const char* name) : name(name), start(timestamp()) {}
+    ~Scope() { threadBuffer().record(name, start, timestamp()); }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+} // namespace Trace
+
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+#ifdef ENABLE_TRACING
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#endif
+
+} // namespace Atom
@@ -85,8 +85,16 @@ int TranspositionTable::hashfull() const {
 
 
 void TranspositionTable::clear() {
-    age = 0;
-    std::memset(table, 0, nbClusters * sizeof(TTCluster));
+    clearPart(0, 1);
+}
+
+
+void TranspositionTable::clearPart(size_t index, size_t count) {
+    const size_t first = nbClusters * index / count;
+    const size_t last  = nbClusters * (index + 1) / count;
+
+    if (index == 0) age = 0;
+    std::memset(&table[first], 0, (last - first) * sizeof(TTCluster));
 }
 
 
@@ -100,8 +108,6 @@ void TranspositionTable::resize(size_t newSize) {
         std::cerr << "Failed to allocate transposition table with " << newSize << "MB." << std::endl;
         exit(EXIT_FAILURE);
     }
-
-    clear();
 }
 
 } // namespace Atom
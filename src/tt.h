@@ -12,6 +12,7 @@ namespace Atom {
 using Key = uint64_t;
 
 constexpr size_t TT_DEFAULT_SIZE = 16;
+constexpr size_t TT_MAX_SIZE     = 4096;
 
 constexpr uint8_t ENTRIES_PER_CLUSTER = 3;
 constexpr uint8_t DEPTH_DELTA = -3;
@@ -107,6 +108,12 @@ public:
         Depth depth, bool isPv, Move move,
         uint8_t age, Bound bound
     );
+
+    // Whether a write would store a position the entry does not already hold
+    // from the current search
+    inline bool isNew(Key key, uint8_t age) const {
+        return !entry->isOccupied() || !entry->hashEquals(key) || entry->age() != age;
+    }
  
 private:
     friend class TranspositionTable;
@@ -129,6 +136,7 @@ class TranspositionTable {
 public:
     TranspositionTable(size_t sizeInMb = TT_DEFAULT_SIZE) : table(nullptr), nbClusters(0), age(0) {
         resize(sizeInMb);
+        clear();
     };
 
     ~TranspositionTable() { aligned_large_pages_free(table); }
@@ -146,9 +154,14 @@ public:
     void   clear();
     void   resize(size_t newSize);
 
+    // Clears the index-th of count equal parts of the table, so that threads
+    // can clear it together. Part 0 also resets the age.
+    void   clearPart(size_t index, size_t count);
+
     inline void onNewSearch() { age += AGE_DELTA; }
 
     inline size_t  size()   const { return nbClusters; }
+    inline size_t  sizeInMb() const { return nbClusters * sizeof(TTCluster) / (1024 * 1024); }
     inline uint8_t getAge() const { return age; }
 
 private:
@@ -71,6 +71,13 @@ namespace Atom {
         TUNABLE(MOVEPICKER_QUIET_THRESHOLD, -3560);
         TUNABLE(MOVEPICKER_GOOD_QUIET_THRESHOLD, -7998);
         TUNABLE(CUTNODE_MIN_DEPTH, 7);
+        TUNABLE(SE_MIN_DEPTH, 6);
+        TUNABLE(SE_TT_DEPTH_MARGIN, 3);
+        TUNABLE(SE_BETA_SCALE, 64);
+        TUNABLE(PROBCUT_MIN_DEPTH, 5);
+        TUNABLE(PROBCUT_DEPTH_REDUCTION, 4);
+        TUNABLE(PROBCUT_MARGIN, 200);
+        TUNABLE(PROBCUT_IMPROVING_MARGIN, 50);
         TUNABLE(SEE_PRUNING_MAX_DEPTH, 10);
         TUNABLE(SEE_PRUNING_CAP_SCORE, 180);
         TUNABLE(SEE_PRUNING_CHK_SCORE, 70);
@@ -135,7 +142,7 @@ namespace Atom {
 
 #ifdef ENABLE_TUNING
         // List of all integer tunable parameters
-        inline std::array<TunableParam, 87> TUNABLE_PARAMS = {{
+        inline std::array<TunableParam, 94> TUNABLE_PARAMS = {{
             {"ASPIRATION_WINDOW_SIZE", &ASPIRATION_WINDOW_SIZE, 5, 2, 8, 1},
                 {"ASPIRATION_WINDOW_DIVISOR", &ASPIRATION_WINDOW_DIVISOR, 13424, 10000, 20000, 100},
                 {"DELTA_INCREMENT_DIV", &DELTA_INCREMENT_DIV, 3, 1, 10, 1},
@@ -172,6 +179,13 @@ namespace Atom {
                 {"MOVEPICKER_QUIET_THRESHOLD", &MOVEPICKER_QUIET_THRESHOLD, -3560, -15000, 15000, 100},
                 {"MOVEPICKER_GOOD_QUIET_THRESHOLD", &MOVEPICKER_GOOD_QUIET_THRESHOLD, -7998, -15000, 15000, 100},
                 {"CUTNODE_MIN_DEPTH", &CUTNODE_MIN_DEPTH, 7, 1, 10, 1},
+                {"SE_MIN_DEPTH", &SE_MIN_DEPTH, 6, 4, 10, 1},
+                {"SE_TT_DEPTH_MARGIN", &SE_TT_DEPTH_MARGIN, 3, 1, 6, 1},
+                {"SE_BETA_SCALE", &SE_BETA_SCALE, 64, 16, 128, 4},
+                {"PROBCUT_MIN_DEPTH", &PROBCUT_MIN_DEPTH, 5, 3, 10, 1},
+                {"PROBCUT_DEPTH_REDUCTION", &PROBCUT_DEPTH_REDUCTION, 4, 2, 6, 1},
+                {"PROBCUT_MARGIN", &PROBCUT_MARGIN, 200, 50, 400, 10},
+                {"PROBCUT_IMPROVING_MARGIN", &PROBCUT_IMPROVING_MARGIN, 50, 0, 150, 5},
                 {"SEE_PRUNING_MAX_DEPTH", &SEE_PRUNING_MAX_DEPTH, 10, 1, 15, 1},
                 {"SEE_PRUNING_CAP_SCORE", &SEE_PRUNING_CAP_SCORE, 180, 1, 1000, 10},
                 {"SEE_PRUNING_CHK_SCORE", &SEE_PRUNING_CHK_SCORE, 70, 1, 1000, 10},
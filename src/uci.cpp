@@ -1,17 +1,26 @@
 #include <algorithm>
+#include <cerrno>
+#include <charconv>
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <iomanip>
+#include <unistd.h>
 
 #include "uci.h"
+#include "bench.h"
+#include "cpu.h"
 #include "movegen.h"
 #include "nnue.h"
 #include "perft.h"
 #include "position.h"
 #include "search.h"
+#include "trace.h"
 #include "types.h"
 
 namespace Atom {
@@ -48,37 +57,58 @@ Square Uci::parseSquare(std::string str) {
 }
 
 
-// Formats the given move according to UCI standard.
-// This is: <square from><square to><promotion piece>
-// e.g "e2e4"
-// or  "e7e8q"
-//
-// Null moves are returned as "0000", although this should
-// not happen in normal play.
-std::string Uci::formatMove(Move m) {
+namespace {
+
+constexpr size_t MAX_MOVE_LENGTH = 6;   // "(none)"
+
+// Writes the move into out, which must hold MAX_MOVE_LENGTH characters,
+// and returns its length. See Uci::formatMove.
+size_t writeMove(char* out, Move m) {
     if (m == MOVE_NONE) {
-        return "(none)";
+        std::memcpy(out, "(none)", 6);
+        return 6;
     } else if (m == MOVE_NULL) {
-        return "0000";
+        std::memcpy(out, "0000", 4);
+        return 4;
     }
 
-    std::string str = formatSquare(moveFrom(m)) + formatSquare(moveTo(m));
+    size_t n = 0;
+    for (Square sq : {moveFrom(m), moveTo(m)}) {
+        out[n++] = 'a' + fileOf(sq);
+        out[n++] = '1' + rankOf(sq);
+    }
 
     if (moveTypeOf(m) == MT_PROMOTION) {
-        str += "?pnbrq?"[movePromotionType(m)];
+        out[n++] = "?pnbrq?"[movePromotionType(m)];
     }
 
-    return str;
+    return n;
+}
+
+} // namespace
+
+
+// Formats the given move according to UCI standard.
+// This is: <square from><square to><promotion piece>
+// e.g "e2e4"
+// or  "e7e8q"
+//
+// Null moves are returned as "0000", although this should
+// not happen in normal play.
+std::string Uci::formatMove(Move m) {
+    char buffer[MAX_MOVE_LENGTH];
+    return std::string(buffer, writeMove(buffer, m));
 }
 
 
 // Converts a UCI move string into a Move.
 // If the move is not in the legal moves, or not a valid move string, returns MOVE_NULL.
-Move Uci::toMove(const Position &pos, std::string moveStr) {
+Move Uci::toMove(const Position &pos, const std::string& moveStr) {
     Move m = MOVE_NULL;
+    char buffer[MAX_MOVE_LENGTH];
 
     Movegen::enumerateLegalMoves(pos, [&](Move move) {
-        if (moveStr == formatMove(move)) {
+        if (moveStr == std::string_view(buffer, writeMove(buffer, move))) {
             m = move;
         }
         return true;
@@ -130,77 +160,180 @@ int Uci::toCentipawns(Value v, const Position &pos) {
 //      mate <x> : Where x is the plies until mate
 //
 std::string Uci::formatScore(const Value& score, const Position& pos) {
+    LineWriter line;
+    return std::string(line.score(score, pos).view());
+}
+
+
+//
+// Output
+//
+
+LineWriter& LineWriter::operator<<(std::string_view s) {
+    const size_t n = std::min(s.size(), SIZE - 1 - length);
+    std::memcpy(buffer + length, s.data(), n);
+    length += n;
+    return *this;
+}
+
+
+LineWriter& LineWriter::operator<<(char c) {
+    if (length < SIZE - 1) buffer[length++] = c;
+    return *this;
+}
+
+
+LineWriter& LineWriter::operator<<(int64_t n) {
+    auto [end, ec] = std::to_chars(buffer + length, buffer + SIZE - 1, n);
+    if (ec == std::errc()) length = end - buffer;
+    return *this;
+}
+
+
+LineWriter& LineWriter::operator<<(uint64_t n) {
+    auto [end, ec] = std::to_chars(buffer + length, buffer + SIZE - 1, n);
+    if (ec == std::errc()) length = end - buffer;
+    return *this;
+}
+
+
+// Writes the given move according to UCI standard. See Uci::formatMove.
+LineWriter& LineWriter::move(Move m) {
+    char buffer[MAX_MOVE_LENGTH];
+    return *this << std::string_view(buffer, writeMove(buffer, m));
+}
+
+
+// Writes the given score. See Uci::formatScore.
+LineWriter& LineWriter::score(Value v, const Position& pos) {
     constexpr int TB_TO_CP = 20000;
 
-    assert(-VALUE_INFINITE < score && VALUE_INFINITE > score);
+    assert(-VALUE_INFINITE < v && VALUE_INFINITE > v);
 
-    const Value absScore = abs(score);
+    const Value absScore = abs(v);
 
     // Regular score
     if (absScore < VALUE_TB_WIN_IN_MAX_PLY) {
-        Value val = Uci::toCentipawns(score, pos);
-        return std::string("cp ") + std::to_string(val);
+        return *this << "cp " << Uci::toCentipawns(v, pos);
     }
 
     // Tablebase score
     else if (absScore <= VALUE_TB) {
-        int ply   = VALUE_TB - absScore;
-        Value val = score > 0 ? TB_TO_CP - ply : -TB_TO_CP + ply;
-        return std::string("cp ") + std::to_string(val);
+        int ply = VALUE_TB - absScore;
+        return *this << "cp " << (v > 0 ? TB_TO_CP - ply : -TB_TO_CP + ply);
     }
 
     // Forced checkmate
     else {
         int ply = VALUE_MATE - absScore;
-        int val = score > 0 ? ((ply + 1) / 2) : (ply / 2);
-        return std::string("mate ") + std::to_string(val);
+        return *this << "mate " << (v > 0 ? ((ply + 1) / 2) : (ply / 2));
     }
 }
 
 
+void LineWriter::flush() {
+    buffer[length++] = '\n';
+
+    // Retry on partial writes and signals
+    const char* data = buffer;
+    while (length > 0) {
+        ssize_t written = write(STDOUT_FILENO, data, length);
+        if (written < 0 && errno != EINTR) break;
+        if (written > 0) {
+            data   += written;
+            length -= written;
+        }
+    }
+
+    length = 0;
+}
+
+
 //
 // UCI callbacks
 //
 
 // Callback when te engine has found the best move and would like to stop searching.
-void Uci::callbackBestMove(const std::string_view bestmove, const std::string_view ponder) {
-    std::cout << "bestmove " << bestmove;
-    if (!ponder.empty()) std::cout << " ponder " << ponder;
-    std::cout << std::endl;
+void Uci::callbackBestMove(const Move bestmove, const Move ponder) {
+    LineWriter line;
+
+    line << "bestmove ";
+    line.move(bestmove);
+
+    if (ponder != MOVE_NONE) {
+        line << " ponder ";
+        line.move(ponder);
+    }
+
+    line.flush();
+}
+
+
+// Reports how many of the TT writes over the last search stored a position
+// that was not already stored, to show how much work the threads duplicated.
+void Uci::callbackTTWrites(const uint64_t writes, const uint64_t unique) {
+    LineWriter line;
+
+    const uint64_t permille = writes ? unique * 1000 / writes : 0;
+
+    line << "info string ttwrites " << writes << " unique " << unique
+         << " (" << permille / 10 << '.' << char('0' + permille % 10) << "%)";
+    line.flush();
+}
+
+
+// Reports how many moves at non-PV nodes were put off over the last search
+// because another thread was searching them.
+void Uci::callbackDeferred(const uint64_t candidates, const uint64_t deferred) {
+    LineWriter line;
+
+    const uint64_t permille = candidates ? deferred * 1000 / candidates : 0;
+
+    line << "info string deferred " << deferred << " of " << candidates
+         << " (" << permille / 10 << '.' << char('0' + permille % 10) << "%)";
+    line.flush();
 }
 
 
 // Callback giving as much data as possible to the GUI.
 // This should be called whenever the engine has updated its depth
-void Uci::callbackInfo(const Search::SearchInfo info) {
-    std::stringstream ss;
-
-    ss << "info";
-    ss << " depth "    << info.depth
-       << " seldepth " << info.selDepth
-       << " score "    << info.score
-       << " nodes "    << info.nodesSearched
-       << " nps "      << (info.nodesSearched * 1000) / (info.timeSearched + 1)
-       << " hashfull " << info.hashFull
-       << " tbhits "   << info.tbHits
-       << " time "     << info.timeSearched
-       << " pv "       << info.pv;
+void Uci::callbackInfo(const Search::SearchInfo& info) {
+    LineWriter line;
+
+    line << "info";
+    line << " depth "    << info.depth
+         << " seldepth " << info.selDepth
+         << " score ";
+    line.score(info.score, *info.rootPos)
+         << " nodes "    << info.nodesSearched
+         << " nps "      << (info.nodesSearched * 1000) / (info.timeSearched + 1)
+         << " hashfull " << info.hashFull
+         << " tbhits "   << info.tbHits
+         << " time "     << info.timeSearched
+         << " pv";
+
+    for (const Move m : info.pv) {
+        line << ' ';
+        line.move(m);
+    }
 
-    std::cout << ss.str() << std::endl;
+    line.flush();
 }
 
 
 // Callback when the engine is currently searching a specific move.
-// This should not be called too frequently, as this can spam the GUI.
+// This should not be called too frequently, as this can spam the GUI:
+// the search rate limits it according to the CurrMoveInterval option.
 void Uci::callbackIter(const Depth depth, const Move currmove, const int currmovenumber) {
-    std::stringstream ss;
+    LineWriter line;
 
-    ss << "info";
-    ss << " depth "          << depth
-       << " currmove "       << Uci::formatMove(currmove)
-       << " currmovenumber " << currmovenumber;
+    line << "info";
+    line << " depth "          << depth
+         << " currmove ";
+    line.move(currmove)
+         << " currmovenumber " << currmovenumber;
 
-    std::cout << ss.str() << std::endl;
+    line.flush();
 }
 
 
@@ -208,49 +341,138 @@ void Uci::callbackIter(const Depth depth, const Move currmove, const int currmov
 //  Main UCI loop.
 //
 
+// The main thread runs commands in the order they were received. Anything
+// other than the urgent commands waits for the current search to finish
+// first, so that it cannot change the engine under a running search.
 void Uci::loop() {
-    std::string token, input;
+    std::thread(&Uci::readInput, this).detach();
 
     while (true) {
-        std::getline(std::cin, input);
-        std::istringstream is(input);
+        std::string input = commands.pop();
+        std::string token;
+        std::istringstream(input) >> token;
+
+        if (!isUrgent(token)) {
+            TRACE_SCOPE("Uci::waitForSearch");
+            engine.waitForSearchFinish();
+        }
+
+        {
+            TRACE_SCOPE("Uci::dispatch");
+            dispatch(input);
+        }
+        --pending;
+    }
+}
+
 
+// Reads commands from stdin on the input thread.
+// The urgent commands must be answered while the main thread is waiting on
+// a search, so they are handled here straight away. If earlier commands are
+// still queued (e.g. a go that has not started yet), they are also queued
+// so that they apply in order. Everything else is only queued.
+void Uci::readInput() {
+    std::string input, token;
+
+    while (std::getline(std::cin, input)) {
         token.clear();
-        is >> std::skipws >> token;
+        std::istringstream(input) >> token;
 
-        if (token[0] == '#') {
-            continue;
-        } else if (token == "uci") {
-            cmdUci();
-        } else if (token == "isready") {
+        if (token == "quit") break;
+
+        if (token == "stop" || token == "ponderhit") {
+            token == "stop" ? engine.stop() : engine.ponderHit();
+            if (pending == 0) continue;
+        } else if (token == "isready" && pending == 0) {
             cmdIsReady();
-        } else if (token == "ucinewgame") {
-            cmdUciNewGame();
-        } else if (token == "position") {
-            cmdPosition(is);
-        } else if (token == "setoption") {
-            cmdSetOption(is);
-        } else if (token == "go") {
-            cmdGo(is);
-        } else if (token == "stop") {
-            cmdStop();
-        } else if (token == "perft") {
-            cmdPerft(is);
-        } else if (token == "perftfile") {
-            cmdPerftFile(is);
-        } else if (token == "debug" || token == "d") {
-            cmdDebug();
-        } else if (token == "quit") {
-            cmdQuit();
-        } else if (token == "clear") {
-            std::cout << "\033[2J\033[1;1H";
-        } else if (token == "visualize" || token == "v") {
-            cmdVisualize(is);
-        } else if (token == "eval") {
-            cmdEval();
-        } else {
-            std::cout << "Error: unknown command '" << token << "'" << std::endl;
+            continue;
         }
+
+        enqueue(input);
+    }
+
+    // Quit (or end of input): stop searching now, and exit once the
+    // commands before it have run.
+    engine.stop();
+    enqueue("quit");
+}
+
+
+void Uci::enqueue(const std::string& input) {
+    ++pending;
+    commands.push(input);
+}
+
+
+// Runs a single command and waits for any search it started to finish.
+// Used to run commands given on the command line.
+void Uci::execute(const std::string& command) {
+    dispatch(command);
+    engine.waitForSearchFinish();
+}
+
+
+// Commands that are answered even while the engine is searching.
+bool Uci::isUrgent(const std::string& token) {
+    return token == "stop" || token == "ponderhit" || token == "isready" || token == "quit";
+}
+
+
+// Runs a single command.
+void Uci::dispatch(const std::string& input) {
+    std::istringstream is(input);
+    std::string token;
+
+    is >> std::skipws >> token;
+
+    if (token[0] == '#') {
+        return;
+    } else if (token == "uci") {
+        cmdUci();
+    } else if (token == "isready") {
+        cmdIsReady();
+    } else if (token == "ucinewgame") {
+        cmdUciNewGame();
+    } else if (token == "position") {
+        cmdPosition(is);
+    } else if (token == "setoption") {
+        cmdSetOption(is);
+    } else if (token == "go") {
+        cmdGo(is);
+    } else if (token == "stop") {
+        cmdStop();
+    } else if (token == "ponderhit") {
+        cmdPonderHit();
+    } else if (token == "perft") {
+        cmdPerft(is);
+    } else if (token == "perftfile") {
+        cmdPerftFile(is);
+    } else if (token == "posbench") {
+        cmdPosBench(is);
+    } else if (token == "bench") {
+        cmdBench(is);
+    } else if (token == "latencybench") {
+        cmdLatencyBench(is);
+    } else if (token == "stats") {
+        cmdStats();
+    } else if (token == "trace") {
+        cmdTrace(is);
+    } else if (token == "convertnet") {
+        cmdConvertNet(is);
+    } else if (token == "evalbatch") {
+        cmdEvalBatch(is);
+    } else if (token == "debug" || token == "d") {
+        cmdDebug();
+    } else if (token == "quit") {
+        cmdQuit();
+    } else if (token == "clear") {
+        std::cout << "\033[2J\033[1;1H";
+    } else if (token == "visualize" || token == "v") {
+        cmdVisualize(is);
+    } else if (token == "eval") {
+        cmdEval();
+    } else {
+        std::cout << "Error: unknown command '" << token << "'" << std::endl;
     }
 }
 
@@ -267,8 +489,16 @@ void Uci::loop() {
 // | setoption name <opt> value <val>  | * Sets the option <opt> to the value <val>   |
 // | go (wtime, btime etc)             | * Searches current position                  |
 // | stop                              |   Finish search threads and report bestmove  |
+// | ponderhit                         |   The opponent played the expected move      |
 // | perft <depth>                     |   Runs perft on current pos to given depth   |
 // | perftfile <file>                  |   Runs all perft tests within a given flie   |
+// | posbench <plies>                  |   Times position commands for a long game    |
+// | bench <depth> <threads> <hash>    |   Searches the bench positions, prints nodes |
+// | latencybench <threads> <runs>     |   Times starting and stopping searches       |
+// | stats                             |   Prints search statistics (make stats only) |
+// | trace <file>                      |   Writes a Chrome trace (make trace only)    |
+// | convertnet <in.nnue> <out>        |   Writes a mappable network cache            |
+// | evalbatch <file> <out>            |   Evaluates every FEN in a file              |
 // | debug (or just "d")               |   Prints the current position + debug info   |
 // | quit                              |   Ends the process                           |
 // | clear                             |   Clears the terminal                        |
@@ -281,11 +511,16 @@ void Uci::cmdUci() {
     std::cout << "id name Atom " << ENGINE_VERSION << std::endl;
     std::cout << "id author George Rawlinson and Tomáš Pecher" << std::endl;
     std::cout << std::endl;
-    std::cout << "option name Threads type spin default 1 min 1 max 16" << std::endl;
+    std::cout << "info string NNUE kernels: " << Cpu::isaName(NNUE::kernel_set().isa)
+              << " (CPU supports " << Cpu::isaName(Cpu::hostIsa()) << ")" << std::endl;
+    std::cout << "option name Threads type spin default " << NB_THREADS_DEFAULT << " min 1 max " << NB_THREADS_MAX << std::endl;
+    std::cout << "option name ThreadBinding type string default none" << std::endl;
     std::cout << "option name EvalFile type string default <inbuilt> " << EvalFileDefaultNameBig << std::endl;
     std::cout << "option name EvalFileSmall type string default <inbuilt> " << EvalFileDefaultNameSmall << std::endl;
-    std::cout << "option name Hash type spin default 16 min 1 max 4096" << std::endl;
+    std::cout << "option name Hash type spin default " << TT_DEFAULT_SIZE << " min 1 max " << TT_MAX_SIZE << std::endl;
     std::cout << "option name Clear Hash type button" << std::endl;
+    std::cout << "option name Ponder type check default false" << std::endl;
+    std::cout << "option name CurrMoveInterval type spin default " << CURRMOVE_INTERVAL_DEFAULT << " min 0 max 60000" << std::endl;
 
 #ifdef ENABLE_TUNING
     // Add all integer tunable parameters
@@ -306,7 +541,9 @@ void Uci::cmdUci() {
 
 
 void Uci::cmdIsReady() {
-    std::cout << "readyok" << std::endl;
+    LineWriter line;
+    line << "readyok";
+    line.flush();
 }
 
 
@@ -370,6 +607,10 @@ void Uci::cmdSetOption(std::istringstream& is) {
             engine.setHashSize(std::stoi(token));
         } else if (optName == "Threads") {
             engine.setNbThreads(std::stoi(token));
+        } else if (optName == "ThreadBinding") {
+            engine.setThreadBinding(token);
+        } else if (optName == "CurrMoveInterval") {
+            engine.setCurrMoveInterval(std::stoi(token));
         }
 #ifdef ENABLE_TUNING
         else {
@@ -435,6 +676,8 @@ Search::SearchLimits Uci::parseGoLimits(std::istringstream& is) {
             is >> limits.moveTime;
         } else if (token == "infinite") {       // Search infinitely until stop command called
             limits.isInfinite = true;
+        } else if (token == "ponder") {         // Search the expected reply until ponderhit
+            limits.isPonder = true;
         }
     }
 
@@ -453,6 +696,11 @@ void Uci::cmdStop() {
 }
 
 
+void Uci::cmdPonderHit() {
+    engine.ponderHit();
+}
+
+
 void Uci::cmdPerft(std::istringstream& is) {
     int depth;
     is >> depth;
@@ -466,6 +714,100 @@ void Uci::cmdPerft(std::istringstream& is) {
     engine.runPerft(depth);
 }
 
+
+void Uci::cmdPosBench(std::istringstream& is) {
+    engine.waitForSearchFinish();
+
+    int plies = 300;
+    is >> plies;
+
+    engine.benchSetPosition(plies);
+}
+
+void Uci::cmdLatencyBench(std::istringstream& is) {
+    engine.waitForSearchFinish();
+
+    int64_t threads = 1;
+    int runs        = 50;
+    is >> threads >> runs;
+
+    if (threads < 1 || threads > int64_t(NB_THREADS_MAX) || runs < 1) {
+        std::cout << "Error: usage is 'latencybench <threads> <runs>', with 1 <= threads <= "
+                  << NB_THREADS_MAX << std::endl;
+        return;
+    }
+
+    engine.benchLatency(size_t(threads), runs);
+}
+
+void Uci::cmdBench(std::istringstream& is) {
+    // Read as signed, so that negative values are rejected rather than wrapping
+    int64_t depth   = Bench::BENCH_DEPTH_DEFAULT;
+    int64_t threads = Bench::BENCH_THREADS_DEFAULT;
+    int64_t hash    = Bench::BENCH_HASH_DEFAULT;
+
+    is >> depth >> threads >> hash;
+
+    if (   depth   < 1 || depth   >= MAX_PLY
+        || threads < 1 || threads > int64_t(NB_THREADS_MAX)
+        || hash    < 1 || hash    > int64_t(TT_MAX_SIZE)) {
+        std::cout << "Error: usage is 'bench [depth] [threads] [hash]', with 1 <= threads <= "
+                  << NB_THREADS_MAX << " and 1 <= hash <= " << TT_MAX_SIZE << std::endl;
+        return;
+    }
+
+    engine.runBench(int(depth), size_t(threads), size_t(hash));
+}
+
+void Uci::cmdStats() {
+    engine.printStats();
+}
+
+void Uci::cmdTrace(std::istringstream& is) {
+#ifdef ENABLE_TRACING
+    std::string filename = "atom-trace.json";
+    is >> filename;
+
+    engine.waitForSearchFinish();
+
+    std::ofstream file(filename);
+    if (!file) {
+        std::cout << "Error: could not open '" << filename << "'" << std::endl;
+        return;
+    }
+
+    const size_t events = Trace::writeChromeJson(file);
+    std::cout << "Wrote " << events << " trace events to " << filename << std::endl;
+#else
+    (void)is;
+    std::cout << "Error: tracing is not enabled, build with 'make trace'" << std::endl;
+#endif
+}
+
+void Uci::cmdConvertNet(std::istringstream& is) {
+    std::string input, output;
+    is >> input >> output;
+
+    if (input.empty() || output.empty()) {
+        std::cout << "Error: usage is 'convertnet <input.nnue> <output>'" << std::endl;
+        return;
+    }
+
+    engine.convertNetwork(input, output);
+}
+
+void Uci::cmdEvalBatch(std::istringstream& is) {
+    std::string input, output;
+    is >> input >> output;
+
+    if (input.empty()) {
+        std::cout << "Error: usage is 'evalbatch <file> [output]'" << std::endl;
+        return;
+    }
+
+    engine.evalBatch(input, output);
+}
+
 void Uci::cmdPerftFile(std::istringstream& is) {
     std::string filename;
     is >> filename;
@@ -479,6 +821,7 @@ void Uci::cmdDebug() {
 
 void Uci::cmdQuit() {
     engine.stop();
+    engine.waitForSearchFinish();
     exit(EXIT_SUCCESS);
 }
 
@@ -1,9 +1,13 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <sstream>
 #include <string>
 #include <string_view>
 
+#include "commandqueue.h"
 #include "engine.h"
 #include "position.h"
 #include "search.h"
@@ -13,9 +17,38 @@ namespace Atom {
 
 #define ENGINE_VERSION "1.0.0"
 
+
+// Builds a line of output in a fixed size buffer and writes it to stdout
+// with a single write(2) call. This keeps the output during search free of
+// allocations, and stops lines written by different threads interleaving.
+class LineWriter {
+public:
+    LineWriter& operator<<(std::string_view s);
+    LineWriter& operator<<(char c);
+    LineWriter& operator<<(int64_t n);
+    LineWriter& operator<<(uint64_t n);
+    LineWriter& operator<<(int n)    { return *this << int64_t(n);  }
+
+    LineWriter& move(Move m);
+    LineWriter& score(Value v, const Position& pos);
+
+    // Writes the line to stdout followed by a newline, and empties the buffer.
+    void flush();
+
+    std::string_view view() const { return {buffer, length}; }
+
+private:
+    static constexpr size_t SIZE = 4096;
+
+    char   buffer[SIZE];
+    size_t length = 0;
+};
+
+
 class Uci {
 public:
-    void loop();          // Main loop
+    void loop();                                // Main loop
+    void execute(const std::string& command);   // Runs a single command to completion
 
     static std::string toLower(std::string s);
 
@@ -24,18 +57,29 @@ public:
     static std::string formatSquare(Square sq);
     static std::string formatMove(Move m);
     static std::string formatScore(const Value& score, const Position& pos);
-    static Move toMove(const Position& pos, std::string moveStr);
+    static Move toMove(const Position& pos, const std::string& moveStr);
 
     static int toCentipawns(Value v, const Position &pos);
 
     // Callbacks for engine
-    static void callbackBestMove(const std::string_view bestmove, const std::string_view ponder);
-    static void callbackInfo(const Search::SearchInfo info);
+    static void callbackBestMove(const Move bestmove, const Move ponder);
+    static void callbackInfo(const Search::SearchInfo& info);
     static void callbackIter(const Depth depth, const Move currmove, const int currmovenumber);
+    static void callbackTTWrites(const uint64_t writes, const uint64_t unique);
+    static void callbackDeferred(const uint64_t candidates, const uint64_t deferred);
 
 private:
     Engine engine;
 
+    // Input is read on its own thread and handed to the main thread here
+    CommandQueue commands;
+    std::atomic<int> pending = 0;       // Commands queued or running on the main thread
+
+    void readInput();
+    void enqueue(const std::string& input);
+    void dispatch(const std::string& input);
+    static bool isUrgent(const std::string& token);
+
     Search::SearchLimits parseGoLimits(std::istringstream& is);
 
     // UCI commands
@@ -46,9 +90,17 @@ private:
     void cmdSetOption(std::istringstream& is);
     void cmdGo(std::istringstream& is);
     void cmdStop();
+    void cmdPonderHit();
     void cmdQuit();
     void cmdPerft(std::istringstream& is);
     void cmdPerftFile(std::istringstream& is);
+    void cmdPosBench(std::istringstream& is);
+    void cmdBench(std::istringstream& is);
+    void cmdLatencyBench(std::istringstream& is);
+    void cmdStats();
+    void cmdTrace(std::istringstream& is);
+    void cmdConvertNet(std::istringstream& is);
+    void cmdEvalBatch(std::istringstream& is);
     void cmdDebug();
     void cmdVisualize(std::istringstream& is);
     void cmdEval();
@@ -1,5 +1,8 @@
 
+#include <cassert>
+
 #include "zobrist.h"
+#include "bitboard.h"
 #include "tt.h"
 #include "types.h"
 
@@ -13,6 +16,9 @@ Key castlingKeys[CASTLING_RIGHT_NB];
 Key sideToMoveKey;
 Key noPawnsKey;
 
+Key  cuckoo[CUCKOO_SIZE];
+Move cuckooMove[CUCKOO_SIZE];
+
 Key rand_u64() {
     // TODO: see if there is a better seed: this was chosen at random
     static Key seed = 0x4E4B705B92903BA4ull;
@@ -23,6 +29,62 @@ Key rand_u64() {
     return val ^ (val >> 31);
 }
 
+// Returns the squares a non-pawn piece attacks from a square on an empty board.
+Bitboard emptyBoardAttacks(PieceType pt, Square s) {
+    switch (pt) {
+        case KNIGHT: return attacks<KNIGHT>(s);
+        case BISHOP: return attacks<BISHOP>(s);
+        case ROOK:   return attacks<ROOK>(s);
+        case QUEEN:  return attacks<QUEEN>(s);
+        case KING:   return attacks<KING>(s);
+        default:     return EMPTY;
+    }
+}
+
+
+// Fills the cuckoo tables with every reversible move.
+// Each move is inserted at one of its two hash slots, kicking any
+// existing entry out to that entry's other slot until all moves fit.
+// See "Detecting upcoming repetitions" by Marcel van Kervinck.
+void initCuckoo() {
+    for (int i = 0; i < CUCKOO_SIZE; ++i) {
+        cuckoo[i]     = 0;
+        cuckooMove[i] = MOVE_NONE;
+    }
+
+    [[maybe_unused]] int count = 0;
+
+    for (Piece p = W_PAWN; p < PIECE_NB; ++p) {
+        if (!isValidPiece(p) || typeOf(p) == PAWN) continue;
+
+        for (Square s1 = SQ_A1; s1 < SQUARE_NB; ++s1) {
+            for (Square s2 = Square(s1 + 1); s2 < SQUARE_NB; ++s2) {
+                if (!(emptyBoardAttacks(typeOf(p), s1) & s2)) continue;
+
+                Move move = makeMove(s1, s2);
+                Key  key  = keys[p][s1] ^ keys[p][s2] ^ sideToMoveKey;
+                int  i    = cuckooH1(key);
+
+                while (true) {
+                    std::swap(cuckoo[i], key);
+                    std::swap(cuckooMove[i], move);
+
+                    // Arrived at an empty slot
+                    if (move == MOVE_NONE) break;
+
+                    // Push the victim to its alternative slot
+                    i = (i == cuckooH1(key)) ? cuckooH2(key) : cuckooH1(key);
+                }
+
+                ++count;
+            }
+        }
+    }
+
+    assert(count == 3668);
+}
+
+
 void init() {
     for (Piece i = W_PAWN; i < PIECE_NB; ++i) {
         for (Square j = SQ_A1; j < SQUARE_NB; ++j) {
@@ -41,6 +103,8 @@ void init() {
 
     sideToMoveKey = rand_u64();
     noPawnsKey    = rand_u64();
+
+    initCuckoo();
 }
 
 } // namespace Zobrist
@@ -14,6 +14,18 @@ extern Key castlingKeys[CASTLING_RIGHT_NB];
 extern Key sideToMoveKey;
 extern Key noPawnsKey;
 
+// Cuckoo tables, used to detect upcoming repetitions.
+// These hold the keys and moves of all reversible (non-pawn) moves
+// on an empty board, indexed by the two hash functions below.
+constexpr int CUCKOO_SIZE = 8192;
+
+extern Key  cuckoo[CUCKOO_SIZE];
+extern Move cuckooMove[CUCKOO_SIZE];
+
+inline int cuckooH1(Key h) { return h & (CUCKOO_SIZE - 1); }
+inline int cuckooH2(Key h) { return (h >> 16) & (CUCKOO_SIZE - 1); }
+
+// Requires the bitboard lookups (initBBs) to be initialized first.
 void init();
 
 } // namespace Zobrist